@@ -0,0 +1,152 @@
+/*!
+ * \file async_grid_writer.cpp
+ * Author: Stephan Grein
+ */
+
+#include "async_grid_writer.h"
+#include "crack_generator_util.h"
+#include <exception>
+#include <sstream>
+
+namespace ug {
+	namespace crack_generator {
+		////////////////////////////////////////////////////////////////////////////////
+		/// AsyncGridWriter
+		////////////////////////////////////////////////////////////////////////////////
+		AsyncGridWriter::AsyncGridWriter
+		(
+			size_t capacity
+		) : m_capacity(capacity), m_bBusy(false), m_bStop(false)
+		{
+			UG_COND_THROW(capacity == 0, "Capacity of the writer queue has to be positive.");
+			m_thread = std::thread(&AsyncGridWriter::run, this);
+		}
+
+		////////////////////////////////////////////////////////////////////////////////
+		/// ~AsyncGridWriter
+		////////////////////////////////////////////////////////////////////////////////
+		AsyncGridWriter::~AsyncGridWriter()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_bStop = true;
+			}
+			m_cvQueued.notify_all();
+			m_thread.join();
+			for (size_t i = 0; i < m_errors.size(); i++) {
+				UG_LOGN("Warning: " << m_errors[i])
+			}
+		}
+
+		////////////////////////////////////////////////////////////////////////////////
+		/// save
+		////////////////////////////////////////////////////////////////////////////////
+		void AsyncGridWriter::save
+		(
+			Grid& g,
+			SubsetHandler& sh,
+			const char* filename
+		)
+		{
+			throw_errors();
+
+			/// copy before locking, thus copying overlaps with writing
+			Snapshot* snapshot = new Snapshot();
+			snapshot->filename = filename;
+			try {
+				CopyGrid(g, sh, snapshot->grid, snapshot->sh);
+			} catch (...) {
+				delete snapshot;
+				throw;
+			}
+
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_cvWritten.wait(lock, [this] {return m_queue.size() < m_capacity;});
+				m_queue.push_back(snapshot);
+			}
+			m_cvQueued.notify_one();
+		}
+
+		////////////////////////////////////////////////////////////////////////////////
+		/// flush
+		////////////////////////////////////////////////////////////////////////////////
+		void AsyncGridWriter::flush()
+		{
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_cvWritten.wait(lock, [this] {return m_queue.empty() && !m_bBusy;});
+			}
+			throw_errors();
+		}
+
+		////////////////////////////////////////////////////////////////////////////////
+		/// throw_errors
+		////////////////////////////////////////////////////////////////////////////////
+		void AsyncGridWriter::throw_errors()
+		{
+			std::vector<std::string> errors;
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				errors.swap(m_errors);
+			}
+			if (errors.empty()) {
+				return;
+			}
+
+			std::stringstream msg;
+			msg << errors.size() << " grid file(s) could not be written:";
+			for (size_t i = 0; i < errors.size(); i++) {
+				msg << "\n" << errors[i];
+			}
+			UG_THROW(msg.str());
+		}
+
+		////////////////////////////////////////////////////////////////////////////////
+		/// run
+		////////////////////////////////////////////////////////////////////////////////
+		void AsyncGridWriter::run()
+		{
+			for (;;) {
+				Snapshot* snapshot;
+				{
+					std::unique_lock<std::mutex> lock(m_mutex);
+					m_cvQueued.wait(lock, [this] {return m_bStop || !m_queue.empty();});
+					/// remaining snapshots are written before stopping
+					if (m_queue.empty()) {
+						return;
+					}
+					snapshot = m_queue.front();
+					m_queue.pop_front();
+					m_bBusy = true;
+				}
+				/// a slot became free
+				m_cvWritten.notify_all();
+
+				/// errors are only collected, logging and throwing happen on the calling thread
+				std::string error;
+				try {
+					if (!SaveGridToFile(snapshot->grid, snapshot->sh, snapshot->filename.c_str())) {
+						error = snapshot->filename + ": SaveGridToFile failed";
+					}
+				} catch (UGError& err) {
+					error = snapshot->filename + ": " + err.get_msg();
+				} catch (std::exception& ex) {
+					error = snapshot->filename + ": " + ex.what();
+				} catch (...) {
+					error = snapshot->filename + ": unknown error";
+				}
+				delete snapshot;
+
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					if (!error.empty()) {
+						m_errors.push_back(error);
+					}
+					m_bBusy = false;
+				}
+				m_cvWritten.notify_all();
+			}
+		}
+	}
+}
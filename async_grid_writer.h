@@ -0,0 +1,88 @@
+/*!
+ * \file async_grid_writer.h
+ * Author: Stephan Grein
+ */
+#ifndef UG__PLUGINS__CRACK_GENERATOR__ASYNC_GRID_WRITER_H
+#define UG__PLUGINS__CRACK_GENERATOR__ASYNC_GRID_WRITER_H
+
+#include "lib_grid/lib_grid.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ug {
+	namespace crack_generator {
+		/*!
+		 * \brief writes grid files on a background thread
+		 * save copies the grid and its subsets into a snapshot and returns as soon
+		 * as the snapshot is queued, thus the caller may modify or destroy the grid
+		 * right away. At most capacity snapshots are queued, save blocks while the
+		 * queue is full. Files are written in the order they were queued. Failed
+		 * writes are collected and thrown by the next call of save or flush.
+		 * The writer thread never logs, messages and errors are reported on the
+		 * calling thread. It assumes that SaveGridToFile on a snapshot may run
+		 * while the calling thread works on other grids, i.e. that lib_grid keeps
+		 * no shared state between grids; ug4 does not document this guarantee.
+		 */
+		class AsyncGridWriter {
+			public:
+				/*!
+				 * \brief starts the writer thread
+				 * \param[in] capacity maximum number of queued snapshots
+				 */
+				AsyncGridWriter(size_t capacity);
+
+				/*!
+				 * \brief writes all queued snapshots and stops the writer thread
+				 * Errors which have not been thrown yet are logged.
+				 */
+				~AsyncGridWriter();
+
+				/*!
+				 * \brief queues a snapshot of the grid for writing
+				 * \param[in] g grid
+				 * \param[in] sh subset handler
+				 * \param[in] filename output file
+				 */
+				void save(Grid& g, SubsetHandler& sh, const char* filename);
+
+				/*!
+				 * \brief waits until all queued snapshots are written
+				 * Throws if any write failed since the last call.
+				 */
+				void flush();
+
+				size_t capacity() const {return m_capacity;}
+
+			private:
+				/// grid and subsets owned by the writer
+				struct Snapshot {
+					Snapshot() : sh(grid) {}
+					Grid grid;
+					SubsetHandler sh;
+					std::string filename;
+				};
+
+				AsyncGridWriter(const AsyncGridWriter&);
+				AsyncGridWriter& operator=(const AsyncGridWriter&);
+
+				void run();
+				void throw_errors();
+
+				size_t m_capacity;
+				std::deque<Snapshot*> m_queue;
+				std::vector<std::string> m_errors;
+				bool m_bBusy;
+				bool m_bStop;
+				std::mutex m_mutex;
+				std::condition_variable m_cvQueued;
+				std::condition_variable m_cvWritten;
+				std::thread m_thread;
+		};
+	}
+}
+
+#endif /// UG__PLUGINS__CRACK_GENERATOR__ASYNC_GRID_WRITER_H
@@ -5,16 +5,306 @@
  */
 
 #include "crack_generator.h"
+#include "crack_generator_util.h"
+#include "surface_validation.h"
+#include "grid_reordering.h"
+#include "async_grid_writer.h"
 #include "lib_grid/lib_grid.h"
 #include "lib_grid/algorithms/geom_obj_util/vertex_util.h"
 #include "lib_grid/algorithms/remeshing/delaunay_triangulation.h"
 #include "lib_grid/refinement/regular_refinement.h"
+#include <algorithm>
 #include <cmath>
 
 #define UG_ENABLE_WARNINGS
 
 namespace ug {
 	namespace crack_generator {
+		////////////////////////////////////////////////////////////////////////////////
+		/// SAVE_GRID
+		////////////////////////////////////////////////////////////////////////////////
+		/*!
+		 * \brief saves the grid directly or hands a snapshot to the writer of the options
+		 */
+		static void SaveGrid
+		(
+			Grid& g,
+			SubsetHandler& sh,
+			const char* filename,
+			const CrackGeneratorOptions& options
+		)
+		{
+			SmartPtr<AsyncGridWriter> writer = options.writer();
+			if (writer.valid()) {
+				writer->save(g, sh, filename);
+			} else {
+				UG_COND_THROW(!SaveGridToFile(g, sh, filename), "Could not write grid to " << filename << ".");
+			}
+		}
+
+		////////////////////////////////////////////////////////////////////////////////
+		/// APPEND_BLOCK_QUADS
+		////////////////////////////////////////////////////////////////////////////////
+		/*!
+		 * \brief appends the cells of a structured block counterclockwise in the xy plane
+		 */
+		static void AppendBlockQuads
+		(
+			const std::vector<Vertex*>& nodes,
+			size_t n,
+			size_t m,
+			int si,
+			Grid::VertexAttachmentAccessor<APosition>& aaPos,
+			std::vector<Vertex*>& quadVrts,
+			std::vector<int>& quadSubsets
+		)
+		{
+			for (size_t j = 0; j < m; j++) {
+				for (size_t i = 0; i < n; i++) {
+					Vertex* q[4] = {nodes[j*(n+1)+i], nodes[j*(n+1)+i+1],
+							nodes[(j+1)*(n+1)+i+1], nodes[(j+1)*(n+1)+i]};
+					const vector3& a = aaPos[q[0]];
+					const vector3& b = aaPos[q[1]];
+					const vector3& c = aaPos[q[2]];
+					const vector3& d = aaPos[q[3]];
+					/// twice the signed area is the cross product of the diagonals
+					if ((c.x()-a.x())*(d.y()-b.y()) - (c.y()-a.y())*(d.x()-b.x()) < 0) {
+						std::swap(q[1], q[3]);
+					}
+					quadVrts.insert(quadVrts.end(), q, q+4);
+					quadSubsets.push_back(si);
+				}
+			}
+		}
+
+		////////////////////////////////////////////////////////////////////////////////
+		/// GET_OR_CREATE_QUAD
+		////////////////////////////////////////////////////////////////////////////////
+		static Face* GetOrCreateQuad(Grid& g, Vertex* v0, Vertex* v1, Vertex* v2, Vertex* v3)
+		{
+			FaceDescriptor fd(4);
+			fd.set_vertex(0, v0);
+			fd.set_vertex(1, v1);
+			fd.set_vertex(2, v2);
+			fd.set_vertex(3, v3);
+			Face* f = g.get_face(fd);
+			if (!f) {
+				f = *g.create<Quadrilateral>(QuadrilateralDescriptor(v0, v1, v2, v3));
+			}
+			return f;
+		}
+
+		////////////////////////////////////////////////////////////////////////////////
+		/// BUILD_COMPLETE_CRACK_STRUCTURED
+		////////////////////////////////////////////////////////////////////////////////
+		/*!
+		 * \brief builds the complete crack as block-structured hexahedral grid
+		 * The squares are homothetic around the crack tip. The inner square is
+		 * split into four blocks meeting at the tip, each ring between two squares
+		 * is a single block wrapped around the tip from one crack face to the other.
+		 * Block interiors are filled by transfinite interpolation and the rings
+		 * are graded radially, so their in-plane cells grow with the distance
+		 * to the tip. By default the layer thickness matches the in-plane size
+		 * of the cells at the tip, thus the tip hexahedra are close to cubes and
+		 * the outer ones are flat. Fewer layers (set_structured_layers) stretch
+		 * the tip hexahedra in z by the logged aspect ratio.
+		 */
+		static void BuildCompleteCrackStructured
+		(
+			number crackInnerLength,
+			number innerThickness,
+			number crackOuterLength,
+			number angle,
+			const CrackGeneratorOptions& options
+		)
+		{
+			/// cells along half a side of the inner square
+			const size_t numCells = options.structured_cells();
+			UG_COND_THROW(numCells == 0, "Number of structured cells has to be positive.");
+			UG_COND_THROW(!(angle > 0 && angle < 45), "Angle has to be between 0 and 45 degree.");
+			UG_COND_THROW(!(innerThickness > 0 && innerThickness < crackInnerLength
+					&& crackInnerLength < crackOuterLength), "Crack lengths have to satisfy "
+					"0 < innerThickness < crackInnerLength < crackOuterLength.");
+
+			/// grid management
+			Grid g;
+			SubsetHandler sh(g);
+			sh.set_default_subset_index(-1);
+			g.attach_to_vertices(aPosition);
+			Grid::VertexAttachmentAccessor<APosition> aaPos(g, aPosition);
+
+			const size_t N = numCells;
+			const int siSquares[3] = {0, 1, 2};
+			const int siLeft = 3, siBack = 4, siFront = 5, siRight = 6;
+			const int siBottom = 7, siTop = 8, siCrack = 9;
+
+			/// crack tip
+			Vertex* crackTipVtx = *g.create<RegularVertex>();
+			aaPos[crackTipVtx] = vector3(0, 0, 0);
+
+			/// boundary of inner, middle and outer square from one crack face around the tip to the other
+			const number lengths[3] = {innerThickness, crackInnerLength, crackOuterLength};
+			number halfSides[3];
+			std::vector<Vertex*> squares[3];
+			for (size_t k = 0; k < 3; k++) {
+				const number d = lengths[k] * cos(deg_to_rad(angle));
+				const number c = lengths[k] * sin(deg_to_rad(angle));
+				halfSides[k] = d;
+				const vector3 corners[9] = {
+					vector3(-d, c, 0), vector3(-d, d, 0), vector3(0, d, 0),
+					vector3(d, d, 0), vector3(d, 0, 0), vector3(d, -d, 0),
+					vector3(0, -d, 0), vector3(-d, -d, 0), vector3(-d, -c, 0)
+				};
+				Vertex* cornerVrts[9];
+				for (size_t i = 0; i < 9; i++) {
+					cornerVrts[i] = *g.create<RegularVertex>();
+					aaPos[cornerVrts[i]] = corners[i];
+				}
+				squares[k].push_back(cornerVrts[0]);
+				for (size_t i = 0; i < 8; i++) {
+					std::vector<Vertex*> line = CreateLine(g, aaPos, cornerVrts[i], cornerVrts[i+1], N, 1);
+					squares[k].insert(squares[k].end(), line.begin()+1, line.end());
+				}
+			}
+
+			std::vector<Vertex*> quadVrts;
+			std::vector<int> quadSubsets;
+			std::vector<std::pair<std::vector<Vertex*>, int> > boundaryLines;
+			std::vector<Vertex*> nodes;
+
+			/// inner square: four blocks between the spokes from the tip to both crack faces and the side midpoints
+			std::vector<Vertex*> spokes[5];
+			for (size_t i = 0; i < 5; i++) {
+				spokes[i] = CreateLine(g, aaPos, crackTipVtx, squares[0][2*i*N], N, 1);
+			}
+			for (size_t i = 0; i < 4; i++) {
+				std::vector<Vertex*> right(squares[0].begin() + 2*i*N, squares[0].begin() + (2*i+1)*N + 1);
+				std::vector<Vertex*> top(squares[0].begin() + (2*i+1)*N, squares[0].begin() + (2*i+2)*N + 1);
+				std::reverse(top.begin(), top.end());
+				FillTransfiniteBlock(g, aaPos, spokes[i], top, spokes[i+1], right, nodes);
+				AppendBlockQuads(nodes, N, N, siSquares[0], aaPos, quadVrts, quadSubsets);
+			}
+			boundaryLines.push_back(std::make_pair(spokes[0], siCrack));
+			boundaryLines.push_back(std::make_pair(spokes[4], siCrack));
+
+			/// middle and outer ring: radial spacing grows like the tangential spacing
+			for (size_t k = 0; k < 2; k++) {
+				const number scale = halfSides[k+1] / halfSides[k];
+				const size_t M = std::max<size_t>(1, static_cast<size_t>(
+						std::floor(std::log(scale) / std::log(1.0 + 1.0 / N) + 0.5)));
+				const number ratio = std::pow(scale, 1.0 / M);
+				std::vector<Vertex*> left = CreateLine(g, aaPos, squares[k].front(), squares[k+1].front(), M, ratio);
+				std::vector<Vertex*> right = CreateLine(g, aaPos, squares[k].back(), squares[k+1].back(), M, ratio);
+				FillTransfiniteBlock(g, aaPos, squares[k], squares[k+1], left, right, nodes);
+				AppendBlockQuads(nodes, 8*N, M, siSquares[k+1], aaPos, quadVrts, quadSubsets);
+				boundaryLines.push_back(std::make_pair(left, siCrack));
+				boundaryLines.push_back(std::make_pair(right, siCrack));
+			}
+
+			/// outer boundary, named as in the unstructured grid: front at y=+d, back at y=-d
+			const std::vector<Vertex*>& outer = squares[2];
+			boundaryLines.push_back(std::make_pair(std::vector<Vertex*>(outer.begin(), outer.begin() + N + 1), siLeft));
+			boundaryLines.push_back(std::make_pair(std::vector<Vertex*>(outer.begin() + N, outer.begin() + 3*N + 1), siFront));
+			boundaryLines.push_back(std::make_pair(std::vector<Vertex*>(outer.begin() + 3*N, outer.begin() + 5*N + 1), siRight));
+			boundaryLines.push_back(std::make_pair(std::vector<Vertex*>(outer.begin() + 5*N, outer.begin() + 7*N + 1), siBack));
+			boundaryLines.push_back(std::make_pair(std::vector<Vertex*>(outer.begin() + 7*N, outer.end()), siLeft));
+
+			/// Extrude towards top, depth as in the unstructured grid
+			const number depth = 2*halfSides[2];
+			const number tipCellSize = halfSides[0] / N;
+			size_t numLayers = options.structured_layers();
+			if (numLayers == 0) {
+				numLayers = static_cast<size_t>(std::ceil(depth / tipCellSize - SMALL));
+			}
+			const vector3 layerStep(0, 0, depth / numLayers);
+			UG_LOGN("Structured grid: " << numLayers << " layers, aspect ratio at crack tip "
+					<< layerStep.z() / tipCellSize)
+			AInt aIndex;
+			g.attach_to_vertices(aIndex);
+			Grid::VertexAttachmentAccessor<AInt> aaIndex(g, aIndex);
+			std::vector<std::vector<Vertex*> > layers(numLayers+1);
+			layers[0].assign(g.begin<Vertex>(), g.end<Vertex>());
+			for (size_t i = 0; i < layers[0].size(); i++) {
+				aaIndex[layers[0][i]] = static_cast<int>(i);
+			}
+			for (size_t k = 1; k <= numLayers; k++) {
+				layers[k].resize(layers[0].size());
+				for (size_t i = 0; i < layers[0].size(); i++) {
+					layers[k][i] = *g.create<RegularVertex>();
+					VecScaleAdd(aaPos[layers[k][i]], 1, aaPos[layers[0][i]], k, layerStep);
+				}
+			}
+
+			std::vector<Face*> boundaryFaces[10];
+			for (size_t q = 0; q < quadSubsets.size(); q++) {
+				int idx[4];
+				for (size_t i = 0; i < 4; i++) {
+					idx[i] = aaIndex[quadVrts[4*q+i]];
+				}
+				for (size_t k = 0; k < numLayers; k++) {
+					const std::vector<Vertex*>& lo = layers[k];
+					const std::vector<Vertex*>& hi = layers[k+1];
+					Volume* hex = *g.create<Hexahedron>(HexahedronDescriptor(lo[idx[0]], lo[idx[1]], lo[idx[2]],
+							lo[idx[3]], hi[idx[0]], hi[idx[1]], hi[idx[2]], hi[idx[3]]));
+					sh.assign_subset(hex, quadSubsets[q]);
+				}
+				const std::vector<Vertex*>& bottom = layers.front();
+				const std::vector<Vertex*>& top = layers.back();
+				boundaryFaces[siBottom].push_back(GetOrCreateQuad(g, bottom[idx[0]], bottom[idx[1]], bottom[idx[2]], bottom[idx[3]]));
+				boundaryFaces[siTop].push_back(GetOrCreateQuad(g, top[idx[0]], top[idx[1]], top[idx[2]], top[idx[3]]));
+			}
+
+			for (size_t l = 0; l < boundaryLines.size(); l++) {
+				const std::vector<Vertex*>& line = boundaryLines[l].first;
+				for (size_t i = 0; i+1 < line.size(); i++) {
+					const int a = aaIndex[line[i]];
+					const int b = aaIndex[line[i+1]];
+					for (size_t k = 0; k < numLayers; k++) {
+						boundaryFaces[boundaryLines[l].second].push_back(GetOrCreateQuad(g, layers[k][a],
+								layers[k][b], layers[k+1][b], layers[k+1][a]));
+					}
+				}
+			}
+			g.detach_from_vertices(aIndex);
+
+			/// Assign closures of volumes first, then boundaries
+			Selector sel(g);
+			for (size_t k = 0; k < 3; k++) {
+				sel.clear();
+				SelectSubsetElements<Volume>(sel, sh, siSquares[k], true);
+				CloseSelection(sel);
+				AssignSelectionToSubset(sel, sh, siSquares[k]);
+			}
+			for (int si = siLeft; si <= siCrack; si++) {
+				sel.clear();
+				for (size_t i = 0; i < boundaryFaces[si].size(); i++) {
+					sel.select(boundaryFaces[si][i]);
+				}
+				CloseSelection(sel);
+				AssignSelectionToSubset(sel, sh, si);
+			}
+			sel.clear();
+
+			/// Rename subsets
+			sh.subset_info(0).name = "Inner square";
+			sh.subset_info(1).name = "Middle square";
+			sh.subset_info(2).name = "Outer square";
+			sh.subset_info(3).name = "Left boundary";
+			sh.subset_info(4).name = "Back boundary";
+			sh.subset_info(5).name = "Front boundary";
+			sh.subset_info(6).name = "Right boundary";
+			sh.subset_info(7).name = "Bottom boundary";
+			sh.subset_info(8).name = "Top boundary";
+			sh.subset_info(9).name = "Crack";
+			AssignSubsetColors(sh);
+
+			UG_LOGN("Structured grid: " << g.num<Hexahedron>() << " hexahedra, " << g.num_vertices() << " vertices")
+			if (!options.reordering().empty()) {
+				ReorderGrid(g, sh, options.reordering());
+			}
+			SaveGrid(g, sh, "crack_generator_structured_final.ugx", options);
+		}
+
 		////////////////////////////////////////////////////////////////////////////////
 		/// BuildCompleteCrack
 		////////////////////////////////////////////////////////////////////////////////
@@ -26,6 +316,24 @@ namespace ug {
 			number angle = 10
 		)
 		{
+			BuildCompleteCrack(crackInnerLength, innerThickness, crackOuterLength, angle, CrackGeneratorOptions());
+		}
+
+		void BuildCompleteCrack
+		(
+			number crackInnerLength,
+			number innerThickness,
+			number crackOuterLength,
+			number angle,
+			const CrackGeneratorOptions& options
+		)
+		{
+			if (options.structured()) {
+				BuildCompleteCrackStructured(crackInnerLength, innerThickness, crackOuterLength,
+						angle, options);
+				return;
+			}
+
 			/// grid management
 			Grid g;
 			SubsetHandler sh(g);
@@ -90,7 +398,7 @@ namespace ug {
 			*g.create<RegularEdge>(EdgeDescriptor(v4, v6));
 
 			AssignSubsetColors(sh);
-			SaveGridToFile(g, sh, "crack_generator_step_1.ugx");
+			SaveGrid(g, sh, "crack_generator_step_1.ugx", options);
 			sh.set_default_subset_index(3);
 
 			/// outermost square
@@ -134,7 +442,7 @@ namespace ug {
 
 			AssignSubsetColors(sh);
 			sh.set_default_subset_index(0);
-			SaveGridToFile(g, sh, "crack_generator_step_2.ugx");
+			SaveGrid(g, sh, "crack_generator_step_2.ugx", options);
 
 			/// innermost square
 			number innerDistance = VecDistance(aaPos[crackBaseTopVtx], aaPos[crackBaseBottomVtx]);
@@ -170,7 +478,7 @@ namespace ug {
 			*g.create<RegularEdge>(EdgeDescriptor(v13, v14));
 
 			AssignSubsetColors(sh);
-			SaveGridToFile(g, sh, "crack_generator_step_3.ugx");
+			SaveGrid(g, sh, "crack_generator_step_3.ugx", options);
 
 			/// middle square (Refine this square)
 			sh.set_default_subset_index(1);
@@ -216,7 +524,7 @@ namespace ug {
 			sh.subset_info(5).name = "Front boundary";
 			sh.subset_info(6).name = "Right boundary";
 			AssignSubsetColors(sh);
-			SaveGridToFile(g, sh, "crack_generator_step_4.ugx");
+			SaveGrid(g, sh, "crack_generator_step_4.ugx", options);
 
 			/// Triangulate bottom surface
 			for (int i = 0; i < sh.num_subsets(); i++) {
@@ -226,7 +534,7 @@ namespace ug {
 			SelectSubsetElements<Face>(sel, sh, 7, true);
 			QualityGridGeneration(g, sel.faces_begin(), sel.faces_end(), aaPos, 10);
 			AssignSubsetColors(sh);
-			SaveGridToFile(g, sh, "crack_generator_step_5.ugx");
+			SaveGrid(g, sh, "crack_generator_step_5.ugx", options);
 
 			/// Extrude towards top
 			vector3 normal = ug::vector3(0, 0, 2*squareOuterDiameter);
@@ -235,22 +543,50 @@ namespace ug {
 				SelectSubsetElements<Edge>(sel, sh, i, true);
 			}
 			edges.assign(sel.edges_begin(), sel.edges_end());
-			Extrude(g, NULL, &edges, NULL, normal, aaPos, EO_CREATE_FACES, NULL);
+			if (options.copy_top()) {
+				/// top is a translated copy of the quality optimized bottom
+				std::vector<Face*> bottomFaces(g.begin<Face>(), g.end<Face>());
+				ExtrudeAndCopyCap(g, sh, edges, bottomFaces, normal, 1, aaPos, 8);
+			} else {
+				Extrude(g, NULL, &edges, NULL, normal, aaPos, EO_CREATE_FACES, NULL);
+			}
 			sh.subset_info(7).name = "Bottom boundary";
 
 			/// Triangulate top surface
-			TriangleFill_SweepLine(g, edges.begin(), edges.end(), aPosition, aInt, &sh, 8);
-			QualityGridGeneration(g, sh.begin<Face>(8), sh.end<Face>(8), aaPos, 30.0);
+			if (!options.copy_top()) {
+				TriangleFill_SweepLine(g, edges.begin(), edges.end(), aPosition, aInt, &sh, 8);
+				QualityGridGeneration(g, sh.begin<Face>(8), sh.end<Face>(8), aaPos, 30.0);
+			}
 			sh.subset_info(8).name = "Top boundary";
 			AssignSubsetColors(sh);
-			SaveGridToFile(g, sh, "crack_generator_step_6.ugx");
+			SaveGrid(g, sh, "crack_generator_step_6.ugx", options);
 
 			/// Tetrahedralize whole grid
+			if (options.validate_surface()) {
+				ValidateSurface(g, sh, aaPos);
+			}
 			Tetrahedralize(g, 5, false, false, aPosition, 1);
+			if (!options.reordering().empty()) {
+				ReorderGrid(g, sh, options.reordering());
+			}
 			AssignSubsetColors(sh);
-			SaveGridToFile(g, sh, "crack_generator_step_7.ugx");
+			SaveGrid(g, sh, "crack_generator_step_7.ugx", options);
 		}
 
+	////////////////////////////////////////////////////////////////////////////////
+	/// RECT_BOUNDARY
+	////////////////////////////////////////////////////////////////////////////////
+	/*!
+	 * \brief boundary lines of a rectangle in construction order
+	 * Left and right run in parallel from the bottom to the top corners, top
+	 * runs from the left to the right corner. Lines may contain double vertices.
+	 */
+	struct RectBoundary {
+		std::vector<Vertex*> left;
+		std::vector<Vertex*> right;
+		std::vector<Vertex*> top;
+	};
+
 	////////////////////////////////////////////////////////////////////////////////
 	/// CREATE_RECT
 	////////////////////////////////////////////////////////////////////////////////
@@ -270,7 +606,9 @@ namespace ug {
 		Selector& sel,
 		number depth,
 		size_t si_offset,
-		std::vector<Vertex*>& verts
+		std::vector<Vertex*>& verts,
+		RectBoundary& boundary,
+		const CrackGeneratorOptions& options
 	)
 	{
 		std::stringstream step;
@@ -283,7 +621,7 @@ namespace ug {
 		Edge* e1 = *g.create<RegularEdge>(EdgeDescriptor(bottomLeftVertex, bottomRightVertex));
 		AssignSubsetColors(sh);
 		step << "crack_generator_simple_step_" << si_offset+1 << ".ugx";
-		SaveGridToFile(g, sh, step.str().c_str());
+		SaveGrid(g, sh, step.str().c_str(), options);
 		step.str(""); step.clear();
 
 		Vertex* leftMDLayerVertex = *g.create<RegularVertex>();
@@ -294,7 +632,7 @@ namespace ug {
 		Edge* e3 = *g.create<RegularEdge>(EdgeDescriptor(bottomRightVertex, rightMDLayerVertex));
 		AssignSubsetColors(sh);
 		step << "crack_generator_simple_step_" << si_offset+2 << ".ugx";
-		SaveGridToFile(g, sh, step.str().c_str());
+		SaveGrid(g, sh, step.str().c_str(), options);
 		step.str(""); step.clear();
 
 		sh.set_default_subset_index(1+si_offset);
@@ -305,7 +643,7 @@ namespace ug {
 		Edge* e4 = *g.create<RegularEdge>(EdgeDescriptor(leftMDLayerVertex, topLeftVertex));
 		AssignSubsetColors(sh);
 		step << "crack_generator_simple_step_" << si_offset+3 << ".ugx";
-		SaveGridToFile(g, sh, step.str().c_str());
+		SaveGrid(g, sh, step.str().c_str(), options);
 		step.str(""); step.clear();
 
 		Edge* e5 = *g.create<RegularEdge>(EdgeDescriptor(rightMDLayerVertex, topRightVertex));
@@ -330,6 +668,7 @@ namespace ug {
 		for (size_t i = 0; i < vertices.size()-1; i++) {
 			*g.create<RegularEdge>(EdgeDescriptor(vertices[i], vertices[i+1]));
 		}
+		boundary.top = vertices;
 		vertices.clear();
 
 		/// REFINE VERTICAL
@@ -384,6 +723,8 @@ namespace ug {
 			*g.create<RegularEdge>(EdgeDescriptor(vertices[i], vertices[i+1]));
 			*g.create<RegularEdge>(EdgeDescriptor(vertices2[i], vertices2[i+1]));
 		}
+		boundary.left = vertices;
+		boundary.right = vertices2;
 		vertices.clear();
 		vertices2.clear();
 
@@ -461,6 +802,9 @@ namespace ug {
 			*g.create<RegularEdge>(EdgeDescriptor(vertices4[i], vertices4[i+1]));
 			*g.create<RegularEdge>(EdgeDescriptor(vertices5[i], vertices5[i+1]));
 		}
+		/// the MD layer corners end the lines of the BD domain and start the lines above
+		boundary.left.insert(boundary.left.begin(), vertices4.begin(), vertices4.end()-1);
+		boundary.right.insert(boundary.right.begin(), vertices5.begin(), vertices5.end()-1);
 
 		vertices.push_back(rightMDLayerVertex);
 		vertices2.push_back(bottomRightVertex);
@@ -480,7 +824,7 @@ namespace ug {
 
 		AssignSubsetColors(sh);
 		step << "crack_generator_simple_step_" << si_offset+4 << ".ugx";
-		SaveGridToFile(g, sh, step.str().c_str());
+		SaveGrid(g, sh, step.str().c_str(), options);
 		step.str(""); step.clear();
 
 		verts.push_back(bottomLeftVertex);
@@ -488,19 +832,36 @@ namespace ug {
 	}
 
 	////////////////////////////////////////////////////////////////////////////////
-	/// BuildSimpleCrack
+	/// BUILD_SIMPLE_CRACK_CELL
 	////////////////////////////////////////////////////////////////////////////////
-	void BuildSimpleCrack
+	/*!
+	 * \brief builds the simple crack geometry into the given grid
+	 * With the periodic option the master/slave vertex pairs of the opposite
+	 * faces are taken from the construction lines: left/right lines for x,
+	 * the top lines of both rectangles for y and the copied top cap for z.
+	 * \param[out] periodicPairs if given, receives the pairs for x, y and z, otherwise
+	 * the pairs for x and z are written next to the final grid
+	 */
+	static void BuildSimpleCrackCell
 	(
+		Grid& g,
+		SubsetHandler& sh,
 		number height,
 		number width,
 		number depth,
 		number thickness,
 		number spacing,
 		number r_0,
-		number h
+		number h,
+		const CrackGeneratorOptions& options,
+		std::vector<VertexPairs>* periodicPairs
 	)
 	{
+		/// opposite faces of the box are triangulated identically
+		const bool periodic = options.periodic();
+		/// front and back have to match for periodicity, thus the top is always copied then
+		const bool copyTop = periodic || options.copy_top();
+
 		/// check user input
 		UG_COND_THROW(thickness >= height || thickness >= width || thickness >= depth,
 				"Thickness of bridging domain layers can't be larger then height of whole geometry.");
@@ -509,8 +870,6 @@ namespace ug {
 		}
 
 		/// grid management
-		Grid g;
-	    SubsetHandler sh(g);
 	    sh.set_default_subset_index(0);
 	    Selector sel(g);
 	    AInt aInt;
@@ -531,7 +890,8 @@ namespace ug {
 		boxes.push_back(std::make_pair(bottomLeft, rightMDLayer));
 		size_t si_offset = 0;
 		std::vector<Vertex*> verts;
-		create_rect(bottomLeft, bottomRight, leftMDLayer, rightMDLayer, topLeft, topRight, g, sh, aaPos, aInt, h*r_0, sel, depth, si_offset, verts);
+		RectBoundary rects[2];
+		create_rect(bottomLeft, bottomRight, leftMDLayer, rightMDLayer, topLeft, topRight, g, sh, aaPos, aInt, h*r_0, sel, depth, si_offset, verts, rects[0], options);
 		si_offset = 3;
 
 		/// Second (lower) rectangle
@@ -543,17 +903,52 @@ namespace ug {
 		topRight = vector3(width, -spacing-height, 0);
 		boxes.push_back(std::make_pair(topLeft, rightMDLayer));
 		boxes.push_back(std::make_pair(leftMDLayer, bottomRight));
-		create_rect(bottomLeft, bottomRight, leftMDLayer, rightMDLayer, topLeft, topRight, g, sh, aaPos, aInt, h*r_0, sel, depth, si_offset, verts);
+		create_rect(bottomLeft, bottomRight, leftMDLayer, rightMDLayer, topLeft, topRight, g, sh, aaPos, aInt, h*r_0, sel, depth, si_offset, verts, rects[1], options);
 
 		/// Connect the lower and upper rectangle
 		sh.set_default_subset_index(2*si_offset);
-		*g.create<RegularEdge>(EdgeDescriptor(verts[0], verts[2]));
-		*g.create<RegularEdge>(EdgeDescriptor(verts[1], verts[3]));
+		std::vector<Vertex*> mdLeft, mdRight;
+		if (periodic) {
+			/// refined like the other lines, thus quality refinement does not split the periodic sides
+			const size_t numCells = std::max<size_t>(1, static_cast<size_t>(std::floor(spacing / (h*r_0) + 0.5)));
+			mdLeft = CreateLine(g, aaPos, verts[2], verts[0], numCells, 1);
+			mdRight = CreateLine(g, aaPos, verts[3], verts[1], numCells, 1);
+			for (size_t i = 0; i+1 < mdLeft.size(); i++) {
+				*g.create<RegularEdge>(EdgeDescriptor(mdLeft[i], mdLeft[i+1]));
+				*g.create<RegularEdge>(EdgeDescriptor(mdRight[i], mdRight[i+1]));
+			}
+		} else {
+			*g.create<RegularEdge>(EdgeDescriptor(verts[0], verts[2]));
+			*g.create<RegularEdge>(EdgeDescriptor(verts[1], verts[3]));
+		}
 		boxes.push_back(std::make_pair(vector3(0, -spacing, 0), ug::vector3(width, 0, 0)));
 
 		AssignSubsetColors(sh);
-		SaveGridToFile(g, sh, "crack_generator_simple_step_8.ugx");
-	    RemoveDoubles<3>(g, g.begin<Vertex>(), g.end<Vertex>(), aaPos, 0.0001);
+		SaveGrid(g, sh, "crack_generator_simple_step_8.ugx", options);
+
+		/// Tag periodic partners by construction index: left/right in x, top of lower/upper rectangle in y
+		const number doublesThreshold = 0.0001;
+		AInt aTags[2];
+		if (periodic) {
+			for (size_t d = 0; d < 2; d++) {
+				g.attach_to_vertices_dv(aTags[d], 0);
+				Grid::VertexAttachmentAccessor<AInt> aaTag(g, aTags[d]);
+				int lastId = 0;
+				if (d == 0) {
+					for (size_t i = 0; i < 2; i++) {
+						TagPeriodicLines(aaPos, aaTag, rects[i].left, rects[i].right, doublesThreshold, lastId);
+					}
+					/// the end points are tagged as corners of the rectangles already
+					const std::vector<Vertex*> mdLeftInner(mdLeft.begin()+1, mdLeft.end()-1);
+					const std::vector<Vertex*> mdRightInner(mdRight.begin()+1, mdRight.end()-1);
+					TagPeriodicLines(aaPos, aaTag, mdLeftInner, mdRightInner, doublesThreshold, lastId);
+				} else {
+					TagPeriodicLines(aaPos, aaTag, rects[1].top, rects[0].top, doublesThreshold, lastId);
+				}
+				SpreadVertexTags(g, aaPos, aaTag, doublesThreshold);
+			}
+		}
+	    RemoveDoubles<3>(g, g.begin<Vertex>(), g.end<Vertex>(), aaPos, doublesThreshold);
 
 		/// Triangulate bottom
 	    /// TODO: Triangulate bottom manually by hand to achieve optimal uniform grid orientation
@@ -562,7 +957,7 @@ namespace ug {
 		}
 		TriangleFill_SweepLine(g, sel.edges_begin(), sel.edges_end(), aPosition, aInt, &sh, sh.num_subsets());
 		AssignSubsetColors(sh);
-		SaveGridToFile(g, sh, "crack_generator_simple_step_9.ugx");
+		SaveGrid(g, sh, "crack_generator_simple_step_9.ugx", options);
 
 		/// Reassign the elements in the layers to subsets -> start beyond the current subsets, thus this ordering is the same as below
 		size_t siFaces = sh.num_subsets()-1;
@@ -594,7 +989,7 @@ namespace ug {
 			SelectSubsetElements<Face>(sel, sh, i, true);
 		}
 		QualityGridGeneration(g, sel.faces_begin(), sel.faces_end(), aaPos, 30);
-		SaveGridToFile(g, sh, "crack_generator_simple_step_10.ugx");
+		SaveGrid(g, sh, "crack_generator_simple_step_10.ugx", options);
 
 		/// Extrude all in steps to ensure uniformity we use h*r_0
 		vector3 normal = ug::vector3(0, 0, depth);
@@ -606,23 +1001,38 @@ namespace ug {
 		VecScale(normal, normal, 0.5/h*r_0);
 		number totalLength = normal.z();
 		UG_LOGN("Extruding...")
-		while (totalLength < depth) {
-			Extrude(g, NULL, &edges, NULL, normal, aaPos, EO_CREATE_FACES, NULL);
-			totalLength += normal.z();
+		VertexColumns columns;
+		if (copyTop) {
+			/// top is a translated copy of the bottom, thus front and back match
+			size_t numSteps = 0;
+			while (totalLength < depth) {
+				numSteps++;
+				totalLength += normal.z();
+			}
+			std::vector<Face*> bottomFaces(g.begin<Face>(), g.end<Face>());
+			ExtrudeAndCopyCap(g, sh, edges, bottomFaces, normal, numSteps, aaPos, -1, periodic ? &columns : NULL);
+		} else {
+			while (totalLength < depth) {
+				Extrude(g, NULL, &edges, NULL, normal, aaPos, EO_CREATE_FACES, NULL);
+				totalLength += normal.z();
+			}
 		}
 		AssignSubsetColors(sh);
-		SaveGridToFile(g, sh, "crack_generator_simple_step_11.ugx");
+		SaveGrid(g, sh, "crack_generator_simple_step_11.ugx", options);
 
 		/// Triangulate top
-		UG_LOGN("Triangulate top surface...")
-		TriangleFill_SweepLine(g, edges.begin(), edges.end(), aPosition, aInt, &sh, sh.num_subsets());
+		if (!copyTop) {
+			UG_LOGN("Triangulate top surface...")
+			TriangleFill_SweepLine(g, edges.begin(), edges.end(), aPosition, aInt, &sh, sh.num_subsets());
+		}
 		AssignSubsetColors(sh);
 		EraseEmptySubsets(sh);
-		SaveGridToFile(g, sh, "crack_generator_simple_step_12.ugx");
+		SaveGrid(g, sh, "crack_generator_simple_step_12.ugx", options);
 
-		siFaces = sh.num_subsets()-1;
+		/// copied top faces are in their layer subsets already, tetrahedra go to the next free subset
+		siFaces = copyTop ? sh.num_subsets() : sh.num_subsets()-1;
 		/// Reassign the elements in the layers to subsets (uses ordering from above)
-		for (size_t i = 0; i < boxes.size(); i++) {
+		for (size_t i = 0; i < boxes.size() && !copyTop; i++) {
 			sel.clear();
 			SelectSubsetElements<Face>(sel, sh, siFaces, true);
 			Selector::traits<Face>::iterator fit = sel.faces_begin();
@@ -644,7 +1054,17 @@ namespace ug {
 		}
 		EraseEmptySubsets(sh);
 		AssignSubsetColors(sh);
-		SaveGridToFile(g, sh, "crack_generator_simple_step_13.ugx");
+		SaveGrid(g, sh, "crack_generator_simple_step_13.ugx", options);
+
+		/// left and right as well as front and back walls have to be split identically
+		if (periodic) {
+			SplitQuadrilaterals(g, sh, aaPos);
+		}
+
+		/// Fail early if the surface is broken, Tetgen would run long and disrespect the boundaries
+		if (options.validate_surface()) {
+			ValidateSurface(g, sh, aaPos);
+		}
 
 		UG_LOGN("Tetrahedralize...")
 		/// Tetrahedralize whole grid (TODO: If we don't pre-refine Tetgen breaks
@@ -653,7 +1073,7 @@ namespace ug {
 
 		EraseEmptySubsets(sh);
 		AssignSubsetColors(sh);
-		SaveGridToFile(g, sh, "crack_generator_simple_step_14.ugx");
+		SaveGrid(g, sh, "crack_generator_simple_step_14.ugx", options);
 
 		/// Reassign the elements in the layers to subsets (uses ordering from above)
 		for (size_t i = 0; i < boxes.size(); i++) {
@@ -722,16 +1142,149 @@ namespace ug {
 		EraseEmptySubsets(sh);
 		sh.subset_info(5).name = "Top";
 		sh.subset_info(6).name = "Bottom";
-		SaveGridToFile(g, sh, "crack_generator_simple_step_15.ugx");
+		SaveGrid(g, sh, "crack_generator_simple_step_15.ugx", options);
 		sel.clear();
 
+		/// Periodic pairs of x and y from the tags, of z from the copied top
+		std::vector<VertexPairs> pairs;
+		if (periodic) {
+			pairs.resize(3);
+			for (size_t d = 0; d < 2; d++) {
+				Grid::VertexAttachmentAccessor<AInt> aaTag(g, aTags[d]);
+				PairTaggedColumns(aaTag, columns, pairs[d]);
+				g.detach_from_vertices(aTags[d]);
+			}
+			for (size_t i = 0; i < columns.size(); i++) {
+				pairs[2].push_back(std::make_pair(columns[i].front(), columns[i].back()));
+			}
+			vector3 boxMin, boxMax;
+			CalculateGridBox(g, aaPos, boxMin, boxMax);
+			for (size_t d = 0; d < 3; d++) {
+				CheckVertexPairs(g, aaPos, pairs[d], d, boxMin, boxMax);
+			}
+		}
+
+		/// Renumber for locality
+		if (!options.reordering().empty()) {
+			ReorderGrid(g, sh, options.reordering(), periodic ? &pairs : NULL);
+		}
+
 		/// Save final grid after optimization
 		UG_LOGN("Writing final grid...")
 		AssignSubsetColors(sh);
-		SaveGridToFile(g, sh, "crack_generator_simple_step_final.ugx");
+		SaveGrid(g, sh, "crack_generator_simple_step_final.ugx", options);
 
 		UG_COND_THROW(sh.num_subsets() != 7, "Number of subsets not seven (7). "
 				"Something must have gone wrong. Use final grid with care!")
+		g.detach_from_vertices(aInt);
+
+		/// Write periodic pairing of left/right (x) and front/back (z) faces
+		if (periodic && periodicPairs) {
+			periodicPairs->swap(pairs);
+		} else if (periodic) {
+			std::vector<VertexPairs> written;
+			written.push_back(pairs[0]);
+			written.push_back(pairs[2]);
+			std::vector<std::string> names;
+			names.push_back("x");
+			names.push_back("z");
+			UG_LOGN("Writing periodic pairing (" << written[0].size() << " x, " << written[1].size() << " z)...")
+			WriteVertexPairs(g, written, names, "crack_generator_simple_step_final_periodic.txt");
 		}
 	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// BuildSimpleCrack
+	////////////////////////////////////////////////////////////////////////////////
+	void BuildSimpleCrack
+	(
+		number height,
+		number width,
+		number depth,
+		number thickness,
+		number spacing,
+		number r_0,
+		number h
+	)
+	{
+		BuildSimpleCrack(height, width, depth, thickness, spacing, r_0, h, CrackGeneratorOptions());
+	}
+
+	void BuildSimpleCrack
+	(
+		number height,
+		number width,
+		number depth,
+		number thickness,
+		number spacing,
+		number r_0,
+		number h,
+		const CrackGeneratorOptions& options
+	)
+	{
+		Grid g;
+		SubsetHandler sh(g);
+		BuildSimpleCrackCell(g, sh, height, width, depth, thickness, spacing, r_0, h, options, NULL);
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// BuildSimpleCrackArray
+	////////////////////////////////////////////////////////////////////////////////
+	void BuildSimpleCrackArray
+	(
+		number height,
+		number width,
+		number depth,
+		number thickness,
+		number spacing,
+		number r_0,
+		number h,
+		size_t nx,
+		size_t ny,
+		size_t nz
+	)
+	{
+		BuildSimpleCrackArray(height, width, depth, thickness, spacing, r_0, h, nx, ny, nz, CrackGeneratorOptions());
+	}
+
+	void BuildSimpleCrackArray
+	(
+		number height,
+		number width,
+		number depth,
+		number thickness,
+		number spacing,
+		number r_0,
+		number h,
+		size_t nx,
+		size_t ny,
+		size_t nz,
+		const CrackGeneratorOptions& options
+	)
+	{
+		UG_COND_THROW(nx == 0 || ny == 0 || nz == 0, "Number of cells has to be positive in each direction.");
+
+		/// mesh a single periodic cell
+		Grid cell;
+		SubsetHandler cellSH(cell);
+		/// the array is reordered as a whole, reordering the template would be wasted
+		CrackGeneratorOptions cellOptions(options);
+		cellOptions.set_periodic(true);
+		cellOptions.set_reordering("");
+		std::vector<VertexPairs> cellPairs;
+		BuildSimpleCrackCell(cell, cellSH, height, width, depth, thickness, spacing, r_0, h, cellOptions, &cellPairs);
+
+		/// copy cell into array, shared faces are merged by the construction pairs of the cell
+		UG_LOGN("Replicating cell " << nx << "x" << ny << "x" << nz << " times...")
+		Grid g;
+		SubsetHandler sh(g);
+		ReplicateCell(cell, cellSH, cellPairs, g, sh, nx, ny, nz);
+		if (!options.reordering().empty()) {
+			ReorderGrid(g, sh, options.reordering());
+		}
+
+		UG_LOGN("Writing final grid...")
+		SaveGrid(g, sh, "crack_generator_simple_array_final.ugx", options);
+	}
+	}
 }
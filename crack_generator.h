@@ -6,9 +6,95 @@
 #define  UG__PLUGINS__CRACK_GENERATOR__CRACK_GENERATOR_H
 
 #include <common/types.h>
+#include "async_grid_writer.h"
+#include "grid_reordering.h"
+#include <string>
 
 namespace ug {
 	namespace crack_generator {
+		/*!
+		 * \brief optional stages of the crack generators
+		 */
+		class CrackGeneratorOptions {
+			public:
+				CrackGeneratorOptions()
+				: m_bPeriodic(false), m_bStructured(false), m_structuredCells(4), m_structuredLayers(0),
+				  m_bCopyTop(false), m_bValidateSurface(false) {}
+
+				/*!
+				 * \brief force matching triangulations on opposite faces in x and z
+				 * The master/slave vertex pairing is written next to the final grid.
+				 * \param[in] periodic
+				 */
+				void set_periodic(bool periodic) {m_bPeriodic = periodic;}
+				bool periodic() const {return m_bPeriodic;}
+
+				/*!
+				 * \brief fill the blocks of the complete crack with a structured hexahedral grid
+				 * \param[in] structured
+				 */
+				void set_structured(bool structured) {m_bStructured = structured;}
+				bool structured() const {return m_bStructured;}
+
+				/*!
+				 * \brief resolution of the structured grid
+				 * \param[in] numCells cells along half a side of the inner square
+				 */
+				void set_structured_cells(size_t numCells) {m_structuredCells = numCells;}
+				size_t structured_cells() const {return m_structuredCells;}
+
+				/*!
+				 * \brief number of hexahedral layers of the structured grid in z
+				 * \param[in] numLayers 0 chooses the layer thickness equal to the cell size at the crack tip
+				 */
+				void set_structured_layers(size_t numLayers) {m_structuredLayers = numLayers;}
+				size_t structured_layers() const {return m_structuredLayers;}
+
+				/*!
+				 * \brief build the top as translated copy of the bottom instead of triangulating it again
+				 * \param[in] copyTop
+				 */
+				void set_copy_top(bool copyTop) {m_bCopyTop = copyTop;}
+				bool copy_top() const {return m_bCopyTop;}
+
+				/*!
+				 * \brief check the surface for holes, duplicates and intersections before tetrahedralization
+				 * Off by default, thus the generators without options behave as before.
+				 * \param[in] validate
+				 */
+				void set_validate_surface(bool validate) {m_bValidateSurface = validate;}
+				bool validate_surface() const {return m_bValidateSurface;}
+
+				/*!
+				 * \brief renumber vertices and elements of the final grid for memory locality
+				 * Unknown methods are rejected here, before any meshing is done.
+				 * \param[in] method "hilbert", "morton", "rcm" or "" (keep TetGen's order)
+				 */
+				void set_reordering(const std::string& method) {
+					UG_COND_THROW(!method.empty() && !IsReorderingMethod(method),
+							"Unknown reordering '" << method << "', use hilbert, morton, rcm or an empty string.");
+					m_reordering = method;
+				}
+				const std::string& reordering() const {return m_reordering;}
+
+				/*!
+				 * \brief writes grid files on the background thread of the given writer
+				 * \param[in] writer shared writer, call its flush before using the files
+				 */
+				void set_writer(SmartPtr<AsyncGridWriter> writer) {m_spWriter = writer;}
+				SmartPtr<AsyncGridWriter> writer() const {return m_spWriter;}
+
+			private:
+				bool m_bPeriodic;
+				bool m_bStructured;
+				size_t m_structuredCells;
+				size_t m_structuredLayers;
+				bool m_bCopyTop;
+				bool m_bValidateSurface;
+				std::string m_reordering;
+				SmartPtr<AsyncGridWriter> m_spWriter;
+		};
+
 		/*!
 		 * \brief builds a complex crack geometry
 		 * \param[in] crackInnerLength
@@ -24,6 +110,23 @@ namespace ug {
 			number angle
 		);
 
+		/*!
+		 * \brief builds a complex crack geometry
+		 * \param[in] crackInnerLength
+		 * \param[in] innerThickness
+		 * \param[in] crackOuterLength
+		 * \param[in] angle
+		 * \param[in] options optional stages
+		 */
+		void BuildCompleteCrack
+		(
+			number crackInnerLength,
+			number innerThickness,
+			number crackOuterLength,
+			number angle,
+			const CrackGeneratorOptions& options
+		);
+
 		/*!
 		 * \brief builds a simple crack geometry
 		 * \param[in] height of cuboid
@@ -44,6 +147,87 @@ namespace ug {
 			number h,
 			number r_0
 		);
+
+		/*!
+		 * \brief builds a simple crack geometry
+		 * \param[in] height of cuboid
+		 * \param[in] width of cuboid
+		 * \param[in] depth of cuboid
+		 * \param[in] thickness of one briding domain
+		 * \param[in] spacing the size of the MD domain
+		 * \param[in] h finess of grid
+		 * \param[in] r_0 lattice constant
+		 * \param[in] options optional stages
+		 */
+		void BuildSimpleCrack
+		(
+			number height,
+			number width,
+			number depth,
+			number thickness,
+			number spacing,
+			number h,
+			number r_0,
+			const CrackGeneratorOptions& options
+		);
+
+		/*!
+		 * \brief builds an array of simple crack geometries
+		 * One periodic cell is meshed once and copied nx*ny*nz times, shared
+		 * faces of neighbouring cells are merged and subsets renumbered per cell.
+		 * \param[in] height of cuboid
+		 * \param[in] width of cuboid
+		 * \param[in] depth of cuboid
+		 * \param[in] thickness of one briding domain
+		 * \param[in] spacing the size of the MD domain
+		 * \param[in] h finess of grid
+		 * \param[in] r_0 lattice constant
+		 * \param[in] nx number of cells in width
+		 * \param[in] ny number of cells in height
+		 * \param[in] nz number of cells in depth
+		 */
+		void BuildSimpleCrackArray
+		(
+			number height,
+			number width,
+			number depth,
+			number thickness,
+			number spacing,
+			number h,
+			number r_0,
+			size_t nx,
+			size_t ny,
+			size_t nz
+		);
+
+		/*!
+		 * \brief builds an array of simple crack geometries
+		 * \param[in] height of cuboid
+		 * \param[in] width of cuboid
+		 * \param[in] depth of cuboid
+		 * \param[in] thickness of one briding domain
+		 * \param[in] spacing the size of the MD domain
+		 * \param[in] h finess of grid
+		 * \param[in] r_0 lattice constant
+		 * \param[in] nx number of cells in width
+		 * \param[in] ny number of cells in height
+		 * \param[in] nz number of cells in depth
+		 * \param[in] options optional stages, the cell is always periodic
+		 */
+		void BuildSimpleCrackArray
+		(
+			number height,
+			number width,
+			number depth,
+			number thickness,
+			number spacing,
+			number h,
+			number r_0,
+			size_t nx,
+			size_t ny,
+			size_t nz,
+			const CrackGeneratorOptions& options
+		);
 	}
 }
 
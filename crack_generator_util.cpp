@@ -0,0 +1,819 @@
+/*!
+ * \file crack_generator_util.cpp
+ * Author: Stephan Grein
+ */
+
+#include "crack_generator_util.h"
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+
+namespace ug {
+	namespace crack_generator {
+		namespace {
+			/// vertices per cell of the spatial hash
+			typedef std::unordered_map<CellKey, std::vector<Vertex*>, CellKeyHash> VertexCells;
+
+			CellKey Cell(const vector3& pos, number cellSize) {
+				return CellKey(static_cast<long>(std::floor(pos.x() / cellSize)),
+						static_cast<long>(std::floor(pos.y() / cellSize)),
+						static_cast<long>(std::floor(pos.z() / cellSize)));
+			}
+
+			/// tag of the tagged vertex closest to pos within threshold, 0 if none
+			int FindTag
+			(
+				const VertexCells& cells,
+				const vector3& pos,
+				Grid::VertexAttachmentAccessor<APosition>& aaPos,
+				Grid::VertexAttachmentAccessor<AInt>& aaTag,
+				number threshold,
+				Vertex* self
+			)
+			{
+				const CellKey key = Cell(pos, threshold);
+				int tag = 0;
+				for (long di = -1; di <= 1; di++) {
+					for (long dj = -1; dj <= 1; dj++) {
+						for (long dk = -1; dk <= 1; dk++) {
+							VertexCells::const_iterator it = cells.find(CellKey(key.i+di, key.j+dj, key.k+dk));
+							if (it == cells.end()) {
+								continue;
+							}
+							for (size_t i = 0; i < it->second.size(); i++) {
+								Vertex* v = it->second[i];
+								if (v == self || VecDistance(aaPos[v], pos) > threshold) {
+									continue;
+								}
+								UG_COND_THROW(tag != 0 && tag != aaTag[v], "Vertices with periodic tags "
+										<< tag << " and " << aaTag[v] << " coincide at " << pos << ".");
+								tag = aaTag[v];
+							}
+						}
+					}
+				}
+				return tag;
+			}
+
+			/// normalized cumulative arc length of a line of vertices
+			std::vector<number> ArcLengthParameters
+			(
+				const std::vector<Vertex*>& line,
+				Grid::VertexAttachmentAccessor<APosition>& aaPos
+			)
+			{
+				std::vector<number> params(line.size(), 0);
+				for (size_t i = 1; i < line.size(); i++) {
+					params[i] = params[i-1] + VecDistance(aaPos[line[i-1]], aaPos[line[i]]);
+				}
+				UG_COND_THROW(!(params.back() > 0), "Degenerated block boundary.");
+				for (size_t i = 1; i < line.size(); i++) {
+					params[i] /= params.back();
+				}
+				return params;
+			}
+
+			/// true if a face of elem is in a boundary subset of a cell
+			template <class TElem>
+			bool HasBoundaryFace
+			(
+				Grid& g,
+				SubsetHandler& sh,
+				TElem* elem,
+				const std::vector<bool>& isBoundary,
+				int siInterface
+			)
+			{
+				for (Grid::AssociatedFaceIterator fit = g.associated_faces_begin(elem);
+						fit != g.associated_faces_end(elem); ++fit) {
+					const int si = sh.get_subset_index(*fit);
+					if (si >= 0 && si < siInterface && isBoundary[si % isBoundary.size()]) {
+						return true;
+					}
+				}
+				return false;
+			}
+
+			/// assigns elem to the cell's copy of subset si if not done by a neighbouring cell before
+			template <class TElem>
+			void AssignCellSubset(SubsetHandler& sh, TElem* elem, int si, int siOffset) {
+				if (si >= 0 && sh.get_subset_index(elem) == -1) {
+					sh.assign_subset(elem, siOffset + si);
+				}
+			}
+		}
+
+		////////////////////////////////////////////////////////////////////////////////
+		/// CalculateGridBox
+		////////////////////////////////////////////////////////////////////////////////
+		void CalculateGridBox
+		(
+			Grid& g,
+			Grid::VertexAttachmentAccessor<APosition>& aaPos,
+			vector3& min,
+			vector3& max
+		)
+		{
+			UG_COND_THROW(g.num_vertices() == 0, "Bounding box of empty grid requested.");
+			min = max = aaPos[*g.begin<Vertex>()];
+			for (VertexIterator vit = g.begin<Vertex>(); vit != g.end<Vertex>(); ++vit) {
+				const vector3& pos = aaPos[*vit];
+				for (size_t d = 0; d < 3; d++) {
+					min[d] = std::min(min[d], pos[d]);
+					max[d] = std::max(max[d], pos[d]);
+				}
+			}
+		}
+
+		////////////////////////////////////////////////////////////////////////////////
+		/// ExtrudeAndCopyCap
+		////////////////////////////////////////////////////////////////////////////////
+		vector3 ExtrudeAndCopyCap
+		(
+			Grid& g,
+			SubsetHandler& sh,
+			std::vector<Edge*>& edges,
+			const std::vector<Face*>& bottomFaces,
+			const vector3& step,
+			size_t numSteps,
+			Grid::VertexAttachmentAccessor<APosition>& aaPos,
+			int si,
+			VertexColumns* columns
+		)
+		{
+			/// collect each extruded vertex once
+			std::vector<Vertex*> bottom;
+			g.begin_marking();
+			for (size_t i = 0; i < edges.size(); i++) {
+				for (size_t j = 0; j < 2; j++) {
+					Vertex* v = edges[i]->vertex(j);
+					if (!g.is_marked(v)) {
+						g.mark(v);
+						bottom.push_back(v);
+					}
+				}
+			}
+			g.end_marking();
+
+			/// extrude layer by layer and follow the extruded edge of each vertex
+			const number tolSq = 1e-12 * VecLengthSq(step);
+			std::vector<Vertex*> layer(bottom);
+			if (columns) {
+				columns->assign(bottom.size(), std::vector<Vertex*>());
+				for (size_t i = 0; i < bottom.size(); i++) {
+					(*columns)[i].push_back(bottom[i]);
+				}
+			}
+			for (size_t s = 0; s < numSteps; s++) {
+				Extrude(g, NULL, &edges, NULL, step, aaPos, EO_CREATE_FACES, NULL);
+				for (size_t i = 0; i < layer.size(); i++) {
+					vector3 target;
+					VecAdd(target, aaPos[layer[i]], step);
+					Vertex* next = NULL;
+					Grid::AssociatedEdgeIterator eit = g.associated_edges_begin(layer[i]);
+					for (; eit != g.associated_edges_end(layer[i]); ++eit) {
+						Vertex* candidate = GetConnectedVertex(*eit, layer[i]);
+						if (VecDistanceSq(aaPos[candidate], target) < tolSq) {
+							next = candidate;
+							break;
+						}
+					}
+					UG_COND_THROW(!next, "Extruded copy of vertex at " << aaPos[layer[i]] << " not found.");
+					layer[i] = next;
+					if (columns) {
+						(*columns)[i].push_back(next);
+					}
+				}
+			}
+
+			vector3 offset;
+			VecScale(offset, step, numSteps);
+
+			/// copy bottom faces to the top, boundary vertices are the extruded ones
+			typedef Attachment<Vertex*> AVertexPtr;
+			AVertexPtr aTop;
+			g.attach_to_vertices_dv(aTop, static_cast<Vertex*>(NULL));
+			Grid::VertexAttachmentAccessor<AVertexPtr> aaTop(g, aTop);
+			for (size_t i = 0; i < bottom.size(); i++) {
+				aaTop[bottom[i]] = layer[i];
+			}
+
+			for (size_t i = 0; i < bottomFaces.size(); i++) {
+				Face* f = bottomFaces[i];
+				FaceDescriptor fd(f->num_vertices());
+				for (size_t j = 0; j < f->num_vertices(); j++) {
+					Vertex* v = f->vertex(j);
+					if (!aaTop[v]) {
+						aaTop[v] = *g.create<RegularVertex>();
+						VecAdd(aaPos[aaTop[v]], aaPos[v], offset);
+						if (columns) {
+							columns->push_back(std::vector<Vertex*>(1, v));
+							columns->back().push_back(aaTop[v]);
+						}
+					}
+					fd.set_vertex(j, aaTop[v]);
+				}
+				Face* top = *g.create_by_cloning(f, fd);
+				sh.assign_subset(top, si == -1 ? sh.get_subset_index(f) : si);
+			}
+			g.detach_from_vertices(aTop);
+			return offset;
+		}
+
+		////////////////////////////////////////////////////////////////////////////////
+		/// SplitQuadrilaterals
+		////////////////////////////////////////////////////////////////////////////////
+		void SplitQuadrilaterals
+		(
+			Grid& g,
+			SubsetHandler& sh,
+			Grid::VertexAttachmentAccessor<APosition>& aaPos
+		)
+		{
+			std::vector<Quadrilateral*> quads(g.begin<Quadrilateral>(), g.end<Quadrilateral>());
+			for (size_t i = 0; i < quads.size(); i++) {
+				Quadrilateral* q = quads[i];
+				size_t first = 0;
+				number minSum = 0;
+				for (size_t j = 0; j < 4; j++) {
+					const vector3& pos = aaPos[q->vertex(j)];
+					number sum = pos.x() + pos.y() + pos.z();
+					if (j == 0 || sum < minSum) {
+						minSum = sum;
+						first = j;
+					}
+				}
+				Vertex* v0 = q->vertex(first);
+				Vertex* v1 = q->vertex((first+1) % 4);
+				Vertex* v2 = q->vertex((first+2) % 4);
+				Vertex* v3 = q->vertex((first+3) % 4);
+				int si = sh.get_subset_index(q);
+				Face* t1 = *g.create<Triangle>(TriangleDescriptor(v0, v1, v2));
+				Face* t2 = *g.create<Triangle>(TriangleDescriptor(v0, v2, v3));
+				sh.assign_subset(t1, si);
+				sh.assign_subset(t2, si);
+				g.erase(q);
+			}
+		}
+
+		////////////////////////////////////////////////////////////////////////////////
+		/// TagPeriodicLines
+		////////////////////////////////////////////////////////////////////////////////
+		void TagPeriodicLines
+		(
+			Grid::VertexAttachmentAccessor<APosition>& aaPos,
+			Grid::VertexAttachmentAccessor<AInt>& aaTag,
+			const std::vector<Vertex*>& masters,
+			const std::vector<Vertex*>& slaves,
+			number threshold,
+			int& lastId
+		)
+		{
+			UG_COND_THROW(masters.size() != slaves.size(), "Periodic lines have " << masters.size()
+					<< " and " << slaves.size() << " vertices.");
+			for (size_t i = 0; i < masters.size(); i++) {
+				const bool masterDouble = i > 0 && VecDistance(aaPos[masters[i]], aaPos[masters[i-1]]) <= threshold;
+				const bool slaveDouble = i > 0 && VecDistance(aaPos[slaves[i]], aaPos[slaves[i-1]]) <= threshold;
+				UG_COND_THROW(masterDouble != slaveDouble, "Periodic lines differ at vertex "
+						<< aaPos[masters[i]] << ", only one of them has a double vertex.");
+				if (!masterDouble) {
+					lastId++;
+				}
+				aaTag[masters[i]] = lastId;
+				aaTag[slaves[i]] = -lastId;
+			}
+		}
+
+		////////////////////////////////////////////////////////////////////////////////
+		/// SpreadVertexTags
+		////////////////////////////////////////////////////////////////////////////////
+		void SpreadVertexTags
+		(
+			Grid& g,
+			Grid::VertexAttachmentAccessor<APosition>& aaPos,
+			Grid::VertexAttachmentAccessor<AInt>& aaTag,
+			number threshold
+		)
+		{
+			UG_COND_THROW(!(threshold > 0), "Threshold has to be positive.");
+			VertexCells cells;
+			for (VertexIterator vit = g.begin<Vertex>(); vit != g.end<Vertex>(); ++vit) {
+				if (aaTag[*vit] != 0) {
+					cells[Cell(aaPos[*vit], threshold)].push_back(*vit);
+				}
+			}
+
+			std::vector<std::pair<Vertex*, int> > spread;
+			for (VertexIterator vit = g.begin<Vertex>(); vit != g.end<Vertex>(); ++vit) {
+				const int tag = FindTag(cells, aaPos[*vit], aaPos, aaTag, threshold, *vit);
+				if (aaTag[*vit] == 0 && tag != 0) {
+					spread.push_back(std::make_pair(*vit, tag));
+				}
+				UG_COND_THROW(aaTag[*vit] != 0 && tag != 0 && tag != aaTag[*vit], "Vertices with periodic tags "
+						<< tag << " and " << aaTag[*vit] << " coincide at " << aaPos[*vit] << ".");
+			}
+			for (size_t i = 0; i < spread.size(); i++) {
+				aaTag[spread[i].first] = spread[i].second;
+			}
+		}
+
+		////////////////////////////////////////////////////////////////////////////////
+		/// PairTaggedColumns
+		////////////////////////////////////////////////////////////////////////////////
+		void PairTaggedColumns
+		(
+			Grid::VertexAttachmentAccessor<AInt>& aaTag,
+			const VertexColumns& columns,
+			VertexPairs& pairs
+		)
+		{
+			std::unordered_map<int, size_t> slaves;
+			size_t numMasters = 0;
+			for (size_t c = 0; c < columns.size(); c++) {
+				const int tag = aaTag[columns[c].front()];
+				if (tag > 0) {
+					numMasters++;
+				} else if (tag < 0) {
+					UG_COND_THROW(!slaves.insert(std::make_pair(-tag, c)).second,
+							"Periodic tag " << tag << " is used twice.");
+				}
+			}
+			UG_COND_THROW(numMasters != slaves.size(), "Found " << numMasters << " master and "
+					<< slaves.size() << " slave vertices, periodic faces do not match.");
+
+			/// masters in column order, thus the pairing is reproducible
+			for (size_t c = 0; c < columns.size(); c++) {
+				const int tag = aaTag[columns[c].front()];
+				if (tag <= 0) {
+					continue;
+				}
+				std::unordered_map<int, size_t>::iterator it = slaves.find(tag);
+				UG_COND_THROW(it == slaves.end(), "Periodic tag " << tag << " is used twice or has no slave.");
+				const std::vector<Vertex*>& master = columns[c];
+				const std::vector<Vertex*>& slave = columns[it->second];
+				UG_COND_THROW(master.size() != slave.size(), "Columns of periodic tag " << tag
+						<< " have " << master.size() << " and " << slave.size() << " vertices.");
+				for (size_t k = 0; k < master.size(); k++) {
+					pairs.push_back(std::make_pair(master[k], slave[k]));
+				}
+				slaves.erase(it);
+			}
+		}
+
+		////////////////////////////////////////////////////////////////////////////////
+		/// CheckVertexPairs
+		////////////////////////////////////////////////////////////////////////////////
+		void CheckVertexPairs
+		(
+			Grid& g,
+			Grid::VertexAttachmentAccessor<APosition>& aaPos,
+			const VertexPairs& pairs,
+			size_t dim,
+			const vector3& min,
+			const vector3& max
+		)
+		{
+			UG_COND_THROW(dim > 2, "Direction has to be 0 (x), 1 (y) or 2 (z).");
+			const number tol = 1e-6 * VecDistance(min, max);
+			const number period = max[dim] - min[dim];
+
+			/// translation and one-to-one
+			g.begin_marking();
+			for (size_t i = 0; i < pairs.size(); i++) {
+				vector3 diff;
+				VecSubtract(diff, aaPos[pairs[i].second], aaPos[pairs[i].first]);
+				diff[dim] -= period;
+				UG_COND_THROW(VecLength(diff) > tol, "Vertex at " << aaPos[pairs[i].second]
+						<< " is not the periodic image of vertex at " << aaPos[pairs[i].first]
+						<< " in direction " << dim << ".");
+				UG_COND_THROW(g.is_marked(pairs[i].first) || g.is_marked(pairs[i].second), "Vertex at "
+						<< aaPos[pairs[i].first] << " is paired twice in direction " << dim << ".");
+				g.mark(pairs[i].first);
+				g.mark(pairs[i].second);
+			}
+			g.end_marking();
+
+			/// completeness: the faces must not have more vertices than pairs
+			size_t numMin = 0, numMax = 0;
+			for (VertexIterator vit = g.begin<Vertex>(); vit != g.end<Vertex>(); ++vit) {
+				const number x = aaPos[*vit][dim];
+				if (std::fabs(x - min[dim]) <= tol) {
+					numMin++;
+				} else if (std::fabs(x - max[dim]) <= tol) {
+					numMax++;
+				}
+			}
+			UG_COND_THROW(numMin != pairs.size() || numMax != pairs.size(), "Faces in direction " << dim
+					<< " have " << numMin << " and " << numMax << " vertices, but " << pairs.size()
+					<< " are paired. The faces were not triangulated identically.");
+		}
+
+		////////////////////////////////////////////////////////////////////////////////
+		/// WriteVertexPairs
+		////////////////////////////////////////////////////////////////////////////////
+		void WriteVertexPairs
+		(
+			Grid& g,
+			const std::vector<VertexPairs>& pairs,
+			const std::vector<std::string>& names,
+			const char* filename
+		)
+		{
+			UG_COND_THROW(pairs.size() != names.size(), "Each group of vertex pairs needs a name.");
+			AInt aIndex;
+			g.attach_to_vertices(aIndex);
+			Grid::VertexAttachmentAccessor<AInt> aaIndex(g, aIndex);
+			int index = 0;
+			for (VertexIterator vit = g.begin<Vertex>(); vit != g.end<Vertex>(); ++vit) {
+				aaIndex[*vit] = index++;
+			}
+
+			std::ofstream out(filename);
+			UG_COND_THROW(!out, "Could not open " << filename << " for writing.");
+			for (size_t i = 0; i < pairs.size(); i++) {
+				out << "# " << names[i] << "\n";
+				for (size_t j = 0; j < pairs[i].size(); j++) {
+					out << aaIndex[pairs[i][j].first] << " " << aaIndex[pairs[i][j].second] << "\n";
+				}
+			}
+			g.detach_from_vertices(aIndex);
+			UG_COND_THROW(!out, "Could not write vertex pairs to " << filename << ".");
+		}
+
+		////////////////////////////////////////////////////////////////////////////////
+		/// CreateLine
+		////////////////////////////////////////////////////////////////////////////////
+		std::vector<Vertex*> CreateLine
+		(
+			Grid& g,
+			Grid::VertexAttachmentAccessor<APosition>& aaPos,
+			Vertex* from,
+			Vertex* to,
+			size_t numCells,
+			number ratio
+		)
+		{
+			UG_COND_THROW(numCells == 0, "A line needs at least one segment.");
+			UG_COND_THROW(!(ratio > 0), "Segment ratio has to be positive.");
+			/// segment lengths grow geometrically: 1, ratio, ratio^2, ...
+			std::vector<number> params(numCells+1, 0);
+			number length = 1;
+			for (size_t i = 1; i <= numCells; i++) {
+				params[i] = params[i-1] + length;
+				length *= ratio;
+			}
+
+			std::vector<Vertex*> line(numCells+1);
+			line.front() = from;
+			line.back() = to;
+			for (size_t i = 1; i < numCells; i++) {
+				line[i] = *g.create<RegularVertex>();
+				VecScaleAdd(aaPos[line[i]], 1.0 - params[i] / params.back(), aaPos[from],
+						params[i] / params.back(), aaPos[to]);
+			}
+			return line;
+		}
+
+		////////////////////////////////////////////////////////////////////////////////
+		/// FillTransfiniteBlock
+		////////////////////////////////////////////////////////////////////////////////
+		void FillTransfiniteBlock
+		(
+			Grid& g,
+			Grid::VertexAttachmentAccessor<APosition>& aaPos,
+			const std::vector<Vertex*>& bottom,
+			const std::vector<Vertex*>& top,
+			const std::vector<Vertex*>& left,
+			const std::vector<Vertex*>& right,
+			std::vector<Vertex*>& nodes
+		)
+		{
+			const size_t n = bottom.size() - 1;
+			const size_t m = left.size() - 1;
+			UG_COND_THROW(n == 0 || m == 0 || top.size() != n+1 || right.size() != m+1,
+					"Opposite sides of a structured block need the same number of vertices.");
+			UG_COND_THROW(bottom.front() != left.front() || bottom.back() != right.front()
+					|| top.front() != left.back() || top.back() != right.back(),
+					"Sides of a structured block have to share their corners.");
+
+			/// blending parameters follow the averaged boundary distribution
+			std::vector<number> sBottom = ArcLengthParameters(bottom, aaPos);
+			std::vector<number> sTop = ArcLengthParameters(top, aaPos);
+			std::vector<number> sLeft = ArcLengthParameters(left, aaPos);
+			std::vector<number> sRight = ArcLengthParameters(right, aaPos);
+
+			const vector3 p00 = aaPos[bottom.front()];
+			const vector3 p10 = aaPos[bottom.back()];
+			const vector3 p01 = aaPos[top.front()];
+			const vector3 p11 = aaPos[top.back()];
+
+			nodes.resize((n+1)*(m+1));
+			for (size_t j = 0; j <= m; j++) {
+				for (size_t i = 0; i <= n; i++) {
+					Vertex*& node = nodes[j*(n+1)+i];
+					if (j == 0) {node = bottom[i]; continue;}
+					if (j == m) {node = top[i]; continue;}
+					if (i == 0) {node = left[j]; continue;}
+					if (i == n) {node = right[j]; continue;}
+
+					const number u = 0.5 * (sBottom[i] + sTop[i]);
+					const number v = 0.5 * (sLeft[j] + sRight[j]);
+					vector3 pos;
+					for (size_t d = 0; d < 3; d++) {
+						pos[d] = (1-v) * aaPos[bottom[i]][d] + v * aaPos[top[i]][d]
+							+ (1-u) * aaPos[left[j]][d] + u * aaPos[right[j]][d]
+							- (1-u) * (1-v) * p00[d] - u * (1-v) * p10[d]
+							- (1-u) * v * p01[d] - u * v * p11[d];
+					}
+					node = *g.create<RegularVertex>();
+					aaPos[node] = pos;
+				}
+			}
+		}
+
+		////////////////////////////////////////////////////////////////////////////////
+		/// ReplicateCell
+		////////////////////////////////////////////////////////////////////////////////
+		void ReplicateCell
+		(
+			Grid& srcGrid,
+			SubsetHandler& srcSH,
+			const std::vector<VertexPairs>& pairs,
+			Grid& destGrid,
+			SubsetHandler& destSH,
+			size_t nx,
+			size_t ny,
+			size_t nz
+		)
+		{
+			UG_COND_THROW(nx == 0 || ny == 0 || nz == 0, "Number of cells has to be positive in each direction.");
+			Grid::VertexAttachmentAccessor<APosition> aaSrcPos(srcGrid, aPosition);
+			if (!destGrid.has_vertex_attachment(aPosition)) {
+				destGrid.attach_to_vertices(aPosition);
+			}
+			Grid::VertexAttachmentAccessor<APosition> aaDestPos(destGrid, aPosition);
+
+			/// index template vertices
+			AInt aIndex;
+			srcGrid.attach_to_vertices(aIndex);
+			Grid::VertexAttachmentAccessor<AInt> aaIndex(srcGrid, aIndex);
+			std::vector<Vertex*> srcVrts(srcGrid.begin<Vertex>(), srcGrid.end<Vertex>());
+			for (size_t i = 0; i < srcVrts.size(); i++) {
+				aaIndex[srcVrts[i]] = static_cast<int>(i);
+			}
+
+			vector3 min, max, period;
+			CalculateGridBox(srcGrid, aaSrcPos, min, max);
+			VecSubtract(period, max, min);
+
+			/// partners[d][i]: index of the vertex on the max face matching vertex i on the min face
+			const size_t counts[3] = {nx, ny, nz};
+			const size_t strides[3] = {1, nx, nx*ny};
+			std::vector<int> partners[3];
+			for (size_t d = 0; d < 3; d++) {
+				partners[d].assign(srcVrts.size(), -1);
+				if (counts[d] < 2) {
+					continue;
+				}
+				UG_COND_THROW(pairs.size() <= d || pairs[d].empty(), "No vertex pairs for replication in direction "
+						<< d << " given.");
+				for (size_t i = 0; i < pairs[d].size(); i++) {
+					partners[d][aaIndex[pairs[d][i].first]] = aaIndex[pairs[d][i].second];
+				}
+
+				/// unpaired vertices would be duplicated and leave a non-conforming seam
+				const number tol = 1e-6 * VecLength(period);
+				std::vector<bool> isPartner(srcVrts.size(), false);
+				for (size_t i = 0; i < srcVrts.size(); i++) {
+					if (partners[d][i] != -1) {
+						isPartner[partners[d][i]] = true;
+					}
+				}
+				for (size_t i = 0; i < srcVrts.size(); i++) {
+					const number x = aaSrcPos[srcVrts[i]][d];
+					UG_COND_THROW(std::fabs(x - min[d]) <= tol && partners[d][i] == -1, "Vertex at "
+							<< aaSrcPos[srcVrts[i]] << " on the min face in direction " << d << " has no partner.");
+					UG_COND_THROW(std::fabs(x - max[d]) <= tol && !isPartner[i], "Vertex at "
+							<< aaSrcPos[srcVrts[i]] << " on the max face in direction " << d << " has no partner.");
+				}
+			}
+
+			const size_t numCells = nx*ny*nz;
+			const int numSubsets = srcSH.num_subsets();
+			std::vector<std::vector<Vertex*> > cellVrts(numCells);
+			destGrid.reserve<Vertex>(numCells * srcVrts.size());
+			destGrid.reserve<Volume>(numCells * srcGrid.num<Volume>());
+			destSH.set_default_subset_index(-1);
+
+			for (size_t c = 0; c < numCells; c++) {
+				const size_t idx[3] = {c % nx, (c / nx) % ny, c / (nx*ny)};
+				vector3 offset(idx[0] * period.x(), idx[1] * period.y(), idx[2] * period.z());
+				const int siOffset = static_cast<int>(c) * numSubsets;
+				std::stringstream suffix;
+				suffix << " (" << idx[0] << "," << idx[1] << "," << idx[2] << ")";
+				for (int si = 0; si < numSubsets; si++) {
+					destSH.subset_info(siOffset + si).name = srcSH.subset_info(si).name + suffix.str();
+				}
+
+				/// vertices on a min face are taken from the neighbouring cell
+				std::vector<Vertex*>& vrts = cellVrts[c];
+				vrts.resize(srcVrts.size());
+				for (size_t i = 0; i < srcVrts.size(); i++) {
+					Vertex* shared = NULL;
+					for (size_t d = 0; d < 3 && !shared; d++) {
+						if (idx[d] > 0 && partners[d][i] != -1) {
+							shared = cellVrts[c - strides[d]][partners[d][i]];
+						}
+					}
+					if (shared) {
+						vrts[i] = shared;
+						continue;
+					}
+					vrts[i] = *destGrid.create<RegularVertex>();
+					VecAdd(aaDestPos[vrts[i]], aaSrcPos[srcVrts[i]], offset);
+					AssignCellSubset(destSH, vrts[i], srcSH.get_subset_index(srcVrts[i]), siOffset);
+				}
+
+				/// volumes first, their sides are then found by index
+				for (VolumeIterator vit = srcGrid.begin<Volume>(); vit != srcGrid.end<Volume>(); ++vit) {
+					Volume* vol = *vit;
+					VolumeDescriptor vd(vol->num_vertices());
+					for (size_t j = 0; j < vol->num_vertices(); j++) {
+						vd.set_vertex(j, vrts[aaIndex[vol->vertex(j)]]);
+					}
+					Volume* newVol = *destGrid.create_by_cloning(vol, vd);
+					AssignCellSubset(destSH, newVol, srcSH.get_subset_index(vol), siOffset);
+				}
+
+				for (FaceIterator fit = srcGrid.begin<Face>(); fit != srcGrid.end<Face>(); ++fit) {
+					Face* f = *fit;
+					FaceDescriptor fd(f->num_vertices());
+					for (size_t j = 0; j < f->num_vertices(); j++) {
+						fd.set_vertex(j, vrts[aaIndex[f->vertex(j)]]);
+					}
+					Face* newFace = destGrid.get_face(fd);
+					if (!newFace) {
+						newFace = *destGrid.create_by_cloning(f, fd);
+					}
+					AssignCellSubset(destSH, newFace, srcSH.get_subset_index(f), siOffset);
+				}
+
+				for (EdgeIterator eit = srcGrid.begin<Edge>(); eit != srcGrid.end<Edge>(); ++eit) {
+					Edge* e = *eit;
+					Vertex* v0 = vrts[aaIndex[e->vertex(0)]];
+					Vertex* v1 = vrts[aaIndex[e->vertex(1)]];
+					Edge* newEdge = destGrid.get_edge(v0, v1);
+					if (!newEdge) {
+						newEdge = *destGrid.create_by_cloning(e, EdgeDescriptor(v0, v1));
+					}
+					AssignCellSubset(destSH, newEdge, srcSH.get_subset_index(e), siOffset);
+				}
+			}
+
+			srcGrid.detach_from_vertices(aIndex);
+
+			/// faces between two cells are no boundary anymore, move them and their closure to one interface subset
+			std::vector<bool> isBoundary(numSubsets);
+			for (int si = 0; si < numSubsets; si++) {
+				isBoundary[si] = srcSH.num<Volume>(si) == 0;
+			}
+			const int siInterface = static_cast<int>(numCells) * numSubsets;
+			destSH.subset_info(siInterface).name = "Interface";
+
+			std::vector<Face*> interfaceFaces;
+			for (FaceIterator fit = destGrid.begin<Face>(); fit != destGrid.end<Face>(); ++fit) {
+				const int si = destSH.get_subset_index(*fit);
+				if (si < 0 || !isBoundary[si % numSubsets]) {
+					continue;
+				}
+				size_t numVolumes = 0;
+				for (Grid::AssociatedVolumeIterator vit = destGrid.associated_volumes_begin(*fit);
+						vit != destGrid.associated_volumes_end(*fit); ++vit) {
+					numVolumes++;
+				}
+				if (numVolumes > 1) {
+					interfaceFaces.push_back(*fit);
+				}
+			}
+			for (size_t i = 0; i < interfaceFaces.size(); i++) {
+				destSH.assign_subset(interfaceFaces[i], siInterface);
+			}
+
+			std::vector<Edge*> interfaceEdges;
+			for (EdgeIterator eit = destGrid.begin<Edge>(); eit != destGrid.end<Edge>(); ++eit) {
+				const int si = destSH.get_subset_index(*eit);
+				if (si >= 0 && si < siInterface && isBoundary[si % numSubsets]
+						&& !HasBoundaryFace(destGrid, destSH, *eit, isBoundary, siInterface)) {
+					interfaceEdges.push_back(*eit);
+				}
+			}
+			std::vector<Vertex*> interfaceVrts;
+			for (VertexIterator vit = destGrid.begin<Vertex>(); vit != destGrid.end<Vertex>(); ++vit) {
+				const int si = destSH.get_subset_index(*vit);
+				if (si >= 0 && si < siInterface && isBoundary[si % numSubsets]
+						&& !HasBoundaryFace(destGrid, destSH, *vit, isBoundary, siInterface)) {
+					interfaceVrts.push_back(*vit);
+				}
+			}
+			for (size_t i = 0; i < interfaceEdges.size(); i++) {
+				destSH.assign_subset(interfaceEdges[i], siInterface);
+			}
+			for (size_t i = 0; i < interfaceVrts.size(); i++) {
+				destSH.assign_subset(interfaceVrts[i], siInterface);
+			}
+
+			EraseEmptySubsets(destSH);
+			AssignSubsetColors(destSH);
+		}
+
+		////////////////////////////////////////////////////////////////////////////////
+		/// CopyGridElements
+		////////////////////////////////////////////////////////////////////////////////
+		void CopyGridElements
+		(
+			Grid& srcGrid,
+			SubsetHandler& srcSH,
+			const std::vector<Vertex*>& vrts,
+			const std::vector<Edge*>& edges,
+			const std::vector<Face*>& faces,
+			const std::vector<Volume*>& vols,
+			Grid& destGrid,
+			SubsetHandler& destSH
+		)
+		{
+			Grid::VertexAttachmentAccessor<APosition> aaSrcPos(srcGrid, aPosition);
+			Grid::VertexAttachmentAccessor<APosition> aaDestPos(destGrid, aPosition);
+			typedef Attachment<Vertex*> AVertexPtr;
+			AVertexPtr aDest;
+			srcGrid.attach_to_vertices(aDest);
+			Grid::VertexAttachmentAccessor<AVertexPtr> aaDest(srcGrid, aDest);
+
+			destGrid.reserve<Vertex>(vrts.size());
+			destGrid.reserve<Edge>(edges.size());
+			destGrid.reserve<Face>(faces.size());
+			destGrid.reserve<Volume>(vols.size());
+
+			for (size_t i = 0; i < vrts.size(); i++) {
+				Vertex* v = *destGrid.create_by_cloning(vrts[i]);
+				aaDestPos[v] = aaSrcPos[vrts[i]];
+				destSH.assign_subset(v, srcSH.get_subset_index(vrts[i]));
+				aaDest[vrts[i]] = v;
+			}
+
+			for (size_t i = 0; i < edges.size(); i++) {
+				EdgeDescriptor ed(aaDest[edges[i]->vertex(0)], aaDest[edges[i]->vertex(1)]);
+				Edge* e = *destGrid.create_by_cloning(edges[i], ed);
+				destSH.assign_subset(e, srcSH.get_subset_index(edges[i]));
+			}
+
+			for (size_t i = 0; i < faces.size(); i++) {
+				FaceDescriptor fd(faces[i]->num_vertices());
+				for (size_t j = 0; j < faces[i]->num_vertices(); j++) {
+					fd.set_vertex(j, aaDest[faces[i]->vertex(j)]);
+				}
+				/// sides are autogenerated if the source grid lacks them
+				Face* f = destGrid.get_face(fd);
+				if (!f) {
+					f = *destGrid.create_by_cloning(faces[i], fd);
+				}
+				destSH.assign_subset(f, srcSH.get_subset_index(faces[i]));
+			}
+
+			for (size_t i = 0; i < vols.size(); i++) {
+				VolumeDescriptor vd(vols[i]->num_vertices());
+				for (size_t j = 0; j < vols[i]->num_vertices(); j++) {
+					vd.set_vertex(j, aaDest[vols[i]->vertex(j)]);
+				}
+				Volume* vol = *destGrid.create_by_cloning(vols[i], vd);
+				destSH.assign_subset(vol, srcSH.get_subset_index(vols[i]));
+			}
+
+			srcGrid.detach_from_vertices(aDest);
+		}
+
+		////////////////////////////////////////////////////////////////////////////////
+		/// CopyGrid
+		////////////////////////////////////////////////////////////////////////////////
+		void CopyGrid
+		(
+			Grid& srcGrid,
+			SubsetHandler& srcSH,
+			Grid& destGrid,
+			SubsetHandler& destSH
+		)
+		{
+			if (!destGrid.has_vertex_attachment(aPosition)) {
+				destGrid.attach_to_vertices(aPosition);
+			}
+			for (int si = 0; si < srcSH.num_subsets(); si++) {
+				destSH.subset_info(si) = srcSH.subset_info(si);
+			}
+			std::vector<Vertex*> vrts(srcGrid.begin<Vertex>(), srcGrid.end<Vertex>());
+			std::vector<Edge*> edges(srcGrid.begin<Edge>(), srcGrid.end<Edge>());
+			std::vector<Face*> faces(srcGrid.begin<Face>(), srcGrid.end<Face>());
+			std::vector<Volume*> vols(srcGrid.begin<Volume>(), srcGrid.end<Volume>());
+			CopyGridElements(srcGrid, srcSH, vrts, edges, faces, vols, destGrid, destSH);
+		}
+	}
+}
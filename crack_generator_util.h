@@ -0,0 +1,303 @@
+/*!
+ * \file crack_generator_util.h
+ * Author: Stephan Grein
+ */
+#ifndef UG__PLUGINS__CRACK_GENERATOR__CRACK_GENERATOR_UTIL_H
+#define UG__PLUGINS__CRACK_GENERATOR__CRACK_GENERATOR_UTIL_H
+
+#include "lib_grid/lib_grid.h"
+#include <string>
+#include <vector>
+#include <utility>
+
+namespace ug {
+	namespace crack_generator {
+		/// (master, slave) vertices on opposite faces of a box shaped grid
+		typedef std::vector<std::pair<Vertex*, Vertex*> > VertexPairs;
+
+		/// copies of a vertex from the bottom to the top of an extrusion
+		typedef std::vector<std::vector<Vertex*> > VertexColumns;
+
+		/// cell of a spatial hash
+		struct CellKey {
+			long i, j, k;
+			CellKey(long i_, long j_, long k_) : i(i_), j(j_), k(k_) {}
+			bool operator==(const CellKey& other) const {
+				return i == other.i && j == other.j && k == other.k;
+			}
+		};
+
+		struct CellKeyHash {
+			size_t operator()(const CellKey& key) const {
+				return static_cast<size_t>(key.i) * 73856093u
+					^ static_cast<size_t>(key.j) * 19349663u
+					^ static_cast<size_t>(key.k) * 83492791u;
+			}
+		};
+
+		/*!
+		 * \brief calculates the axis aligned bounding box of all vertices
+		 * \param[in] g grid
+		 * \param[in] aaPos positions
+		 * \param[out] min lower corner
+		 * \param[out] max upper corner
+		 */
+		void CalculateGridBox
+		(
+			Grid& g,
+			Grid::VertexAttachmentAccessor<APosition>& aaPos,
+			vector3& min,
+			vector3& max
+		);
+
+		/*!
+		 * \brief extrudes the given edges and closes the top with a translated copy of the bottom faces
+		 * Top and bottom triangulations match node for node and the cost of the
+		 * top is linear in the number of bottom faces.
+		 * \param[in] g grid
+		 * \param[in] sh subset handler
+		 * \param[in,out] edges edges to extrude, afterwards the top edges
+		 * \param[in] bottomFaces faces which are copied to the top
+		 * \param[in] step extrusion vector of a single layer
+		 * \param[in] numSteps number of layers
+		 * \param[in] aaPos positions
+		 * \param[in] si subset of top faces, -1 keeps the subsets of the bottom faces
+		 * \param[out] columns if given, the copies of each extruded vertex and of each
+		 * vertex of the bottom faces, from bottom to top
+		 * \return total translation of the top
+		 */
+		vector3 ExtrudeAndCopyCap
+		(
+			Grid& g,
+			SubsetHandler& sh,
+			std::vector<Edge*>& edges,
+			const std::vector<Face*>& bottomFaces,
+			const vector3& step,
+			size_t numSteps,
+			Grid::VertexAttachmentAccessor<APosition>& aaPos,
+			int si = -1,
+			VertexColumns* columns = NULL
+		);
+
+		/*!
+		 * \brief splits all quadrilaterals into two triangles
+		 * The diagonal always starts at the vertex with the smallest coordinate
+		 * sum, thus translated copies of a quadrilateral are split identically.
+		 * \param[in] g grid
+		 * \param[in] sh subset handler
+		 * \param[in] aaPos positions
+		 */
+		void SplitQuadrilaterals
+		(
+			Grid& g,
+			SubsetHandler& sh,
+			Grid::VertexAttachmentAccessor<APosition>& aaPos
+		);
+
+		/*!
+		 * \brief tags two parallel lines of vertices on opposite faces of the grid box
+		 * The i-th master is paired with the i-th slave by their construction
+		 * index. Masters are tagged id, slaves -id. Consecutive vertices closer
+		 * than threshold are removed as doubles later, thus they share an id.
+		 * \param[in] aaPos positions
+		 * \param[in] aaTag tags, 0 for untagged vertices
+		 * \param[in] masters line on the min face
+		 * \param[in] slaves line on the max face
+		 * \param[in] threshold distance of double vertices
+		 * \param[in,out] lastId last id in use
+		 */
+		void TagPeriodicLines
+		(
+			Grid::VertexAttachmentAccessor<APosition>& aaPos,
+			Grid::VertexAttachmentAccessor<AInt>& aaTag,
+			const std::vector<Vertex*>& masters,
+			const std::vector<Vertex*>& slaves,
+			number threshold,
+			int& lastId
+		);
+
+		/*!
+		 * \brief copies the tag of each tagged vertex to all untagged vertices closer than threshold
+		 * Thus the tags survive RemoveDoubles with the same threshold regardless
+		 * of which of the double vertices is kept. Throws if differently tagged
+		 * vertices would be merged.
+		 * \param[in] g grid
+		 * \param[in] aaPos positions
+		 * \param[in] aaTag tags, 0 for untagged vertices
+		 * \param[in] threshold distance of double vertices
+		 */
+		void SpreadVertexTags
+		(
+			Grid& g,
+			Grid::VertexAttachmentAccessor<APosition>& aaPos,
+			Grid::VertexAttachmentAccessor<AInt>& aaTag,
+			number threshold
+		);
+
+		/*!
+		 * \brief pairs the columns of equally tagged master and slave vertices layer by layer
+		 * Throws if a tag has no partner or is used twice.
+		 * \param[in] aaTag tags of the bottom vertices, see TagPeriodicLines
+		 * \param[in] columns extruded vertices, see ExtrudeAndCopyCap
+		 * \param[out] pairs master and slave vertices
+		 */
+		void PairTaggedColumns
+		(
+			Grid::VertexAttachmentAccessor<AInt>& aaTag,
+			const VertexColumns& columns,
+			VertexPairs& pairs
+		);
+
+		/*!
+		 * \brief checks that the pairs match the min and max faces of the grid box one-to-one
+		 * Each slave has to be its master translated by the box length in
+		 * direction dim, and each vertex on the two faces has to be paired.
+		 * \param[in] g grid
+		 * \param[in] aaPos positions
+		 * \param[in] pairs master and slave vertices
+		 * \param[in] dim direction (0: x, 1: y, 2: z)
+		 * \param[in] min lower corner of grid box
+		 * \param[in] max upper corner of grid box
+		 */
+		void CheckVertexPairs
+		(
+			Grid& g,
+			Grid::VertexAttachmentAccessor<APosition>& aaPos,
+			const VertexPairs& pairs,
+			size_t dim,
+			const vector3& min,
+			const vector3& max
+		);
+
+		/*!
+		 * \brief writes vertex pairs as indices into the vertex order of the grid
+		 * Each group starts with a line "# name" followed by one "master slave"
+		 * line per pair, indices refer to the vertices of the written .ugx file.
+		 * \param[in] g grid
+		 * \param[in] pairs groups of vertex pairs
+		 * \param[in] names name of each group
+		 * \param[in] filename output file
+		 */
+		void WriteVertexPairs
+		(
+			Grid& g,
+			const std::vector<VertexPairs>& pairs,
+			const std::vector<std::string>& names,
+			const char* filename
+		);
+
+		/*!
+		 * \brief creates a line of vertices between two existing vertices
+		 * \param[in] g grid
+		 * \param[in] aaPos positions
+		 * \param[in] from first vertex
+		 * \param[in] to last vertex
+		 * \param[in] numCells number of segments
+		 * \param[in] ratio length ratio of consecutive segments (1: uniform)
+		 * \return numCells+1 vertices from first to last vertex
+		 */
+		std::vector<Vertex*> CreateLine
+		(
+			Grid& g,
+			Grid::VertexAttachmentAccessor<APosition>& aaPos,
+			Vertex* from,
+			Vertex* to,
+			size_t numCells,
+			number ratio
+		);
+
+		/*!
+		 * \brief fills a structured block by transfinite interpolation of its boundary vertices
+		 * The block is spanned by bottom and top (n+1 vertices each) and left and
+		 * right (m+1 vertices each). Corners have to be shared, i.e. bottom starts
+		 * at left[0] and ends at right[0], top starts at left[m] and ends at right[m].
+		 * \param[in] g grid
+		 * \param[in] aaPos positions
+		 * \param[in] bottom boundary vertices
+		 * \param[in] top boundary vertices
+		 * \param[in] left boundary vertices
+		 * \param[in] right boundary vertices
+		 * \param[out] nodes block vertices, node (i, j) is stored at j*(n+1)+i
+		 */
+		void FillTransfiniteBlock
+		(
+			Grid& g,
+			Grid::VertexAttachmentAccessor<APosition>& aaPos,
+			const std::vector<Vertex*>& bottom,
+			const std::vector<Vertex*>& top,
+			const std::vector<Vertex*>& left,
+			const std::vector<Vertex*>& right,
+			std::vector<Vertex*>& nodes
+		);
+
+		/*!
+		 * \brief copies a meshed box shaped cell nx*ny*nz times into destination grid
+		 * Shared faces of neighbouring cells are merged by the vertex pairs of
+		 * the template, each cell gets its own copy of the template subsets.
+		 * Every vertex on a min or max face of a replicated direction needs a
+		 * partner. Boundary faces shared by two cells and their closure are moved
+		 * to the subset Interface, subsets left empty are erased.
+		 * \param[in] srcGrid template cell
+		 * \param[in] srcSH subsets of template cell
+		 * \param[in] pairs vertex pairs of the min and max faces in x, y and z, only
+		 * needed in directions with more than one cell
+		 * \param[out] destGrid replicated cells
+		 * \param[out] destSH subsets of replicated cells
+		 * \param[in] nx number of cells in x direction
+		 * \param[in] ny number of cells in y direction
+		 * \param[in] nz number of cells in z direction
+		 */
+		void ReplicateCell
+		(
+			Grid& srcGrid,
+			SubsetHandler& srcSH,
+			const std::vector<VertexPairs>& pairs,
+			Grid& destGrid,
+			SubsetHandler& destSH,
+			size_t nx,
+			size_t ny,
+			size_t nz
+		);
+
+		/*!
+		 * \brief copies the given elements in the given order, lower dimensional elements first
+		 * Sides missing in the source grid are autogenerated in the destination grid.
+		 * \param[in] srcGrid source grid
+		 * \param[in] srcSH subsets of source grid
+		 * \param[in] vrts source vertices
+		 * \param[in] edges source edges
+		 * \param[in] faces source faces
+		 * \param[in] vols source volumes
+		 * \param[out] destGrid destination grid with position attachment
+		 * \param[out] destSH subsets of destination grid
+		 */
+		void CopyGridElements
+		(
+			Grid& srcGrid,
+			SubsetHandler& srcSH,
+			const std::vector<Vertex*>& vrts,
+			const std::vector<Edge*>& edges,
+			const std::vector<Face*>& faces,
+			const std::vector<Volume*>& vols,
+			Grid& destGrid,
+			SubsetHandler& destSH
+		);
+
+		/*!
+		 * \brief copies a grid with its subsets, the element order is kept
+		 * \param[in] srcGrid source grid
+		 * \param[in] srcSH subsets of source grid
+		 * \param[out] destGrid destination grid
+		 * \param[out] destSH subsets of destination grid
+		 */
+		void CopyGrid
+		(
+			Grid& srcGrid,
+			SubsetHandler& srcSH,
+			Grid& destGrid,
+			SubsetHandler& destSH
+		);
+	}
+}
+
+#endif /// UG__PLUGINS__CRACK_GENERATOR__CRACK_GENERATOR_UTIL_H
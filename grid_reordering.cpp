@@ -0,0 +1,331 @@
+/*!
+ * \file grid_reordering.cpp
+ * Author: Stephan Grein
+ */
+
+#include "grid_reordering.h"
+#include "crack_generator_util.h"
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace ug {
+	namespace crack_generator {
+		namespace {
+			/// bits per coordinate of the space-filling curve keys
+			const int CURVE_BITS = 21;
+
+			/// Morton key: interleaved coordinate bits
+			uint64_t MortonKey(const uint32_t coords[3]) {
+				uint64_t key = 0;
+				for (int b = CURVE_BITS-1; b >= 0; b--) {
+					for (size_t i = 0; i < 3; i++) {
+						key = (key << 1) | ((coords[i] >> b) & 1u);
+					}
+				}
+				return key;
+			}
+
+			/// Hilbert key: coordinates transposed as in Skilling, AIP Conf. Proc. 707 (2004)
+			uint64_t HilbertKey(const uint32_t coords[3]) {
+				uint32_t x[3] = {coords[0], coords[1], coords[2]};
+				const uint32_t m = 1u << (CURVE_BITS-1);
+				for (uint32_t q = m; q > 1; q >>= 1) {
+					const uint32_t p = q - 1;
+					for (size_t i = 0; i < 3; i++) {
+						if (x[i] & q) {
+							x[0] ^= p;
+						} else {
+							const uint32_t t = (x[0] ^ x[i]) & p;
+							x[0] ^= t;
+							x[i] ^= t;
+						}
+					}
+				}
+				for (size_t i = 1; i < 3; i++) {
+					x[i] ^= x[i-1];
+				}
+				uint32_t t = 0;
+				for (uint32_t q = m; q > 1; q >>= 1) {
+					if (x[2] & q) {
+						t ^= q - 1;
+					}
+				}
+				for (size_t i = 0; i < 3; i++) {
+					x[i] ^= t;
+				}
+				return MortonKey(x);
+			}
+
+			/// vertex order along a space-filling curve through the grid box
+			void CurveOrder(Grid& g, bool hilbert, std::vector<Vertex*>& order) {
+				Grid::VertexAttachmentAccessor<APosition> aaPos(g, aPosition);
+				vector3 boxMin, boxMax;
+				CalculateGridBox(g, aaPos, boxMin, boxMax);
+				const number maxCoord = static_cast<number>((1u << CURVE_BITS) - 1);
+
+				std::vector<std::pair<uint64_t, size_t> > keys(order.size());
+				for (size_t i = 0; i < order.size(); i++) {
+					const vector3& pos = aaPos[order[i]];
+					uint32_t coords[3];
+					for (size_t d = 0; d < 3; d++) {
+						const number extent = boxMax[d] - boxMin[d];
+						coords[d] = extent > 0 ? static_cast<uint32_t>((pos[d] - boxMin[d]) / extent * maxCoord) : 0;
+					}
+					keys[i] = std::make_pair(hilbert ? HilbertKey(coords) : MortonKey(coords), i);
+				}
+				std::sort(keys.begin(), keys.end());
+
+				std::vector<Vertex*> sorted(order.size());
+				for (size_t i = 0; i < keys.size(); i++) {
+					sorted[i] = order[keys[i].second];
+				}
+				order.swap(sorted);
+			}
+
+			/// reverse Cuthill-McKee order of the vertex adjacency
+			void RCMOrder(Grid& g, Grid::VertexAttachmentAccessor<AInt>& aaIndex, std::vector<Vertex*>& order) {
+				const size_t n = order.size();
+				std::vector<std::vector<int> > adjacency(n);
+				for (EdgeIterator eit = g.begin<Edge>(); eit != g.end<Edge>(); ++eit) {
+					const int i = aaIndex[(*eit)->vertex(0)];
+					const int j = aaIndex[(*eit)->vertex(1)];
+					adjacency[i].push_back(j);
+					adjacency[j].push_back(i);
+				}
+
+				/// candidates for new components in order of increasing degree
+				std::vector<std::pair<size_t, int> > byDegree(n);
+				for (size_t i = 0; i < n; i++) {
+					byDegree[i] = std::make_pair(adjacency[i].size(), static_cast<int>(i));
+				}
+				std::sort(byDegree.begin(), byDegree.end());
+
+				std::vector<int> level(n, -1);
+				std::vector<int> result;
+				result.reserve(n);
+				std::vector<int> queue;
+				queue.reserve(n);
+				for (size_t c = 0; c < n; c++) {
+					int start = byDegree[c].second;
+					if (level[start] != -1) {
+						continue;
+					}
+
+					/// one breadth first search to move the start towards the periphery
+					queue.assign(1, start);
+					level[start] = 0;
+					for (size_t head = 0; head < queue.size(); head++) {
+						const int v = queue[head];
+						for (size_t k = 0; k < adjacency[v].size(); k++) {
+							if (level[adjacency[v][k]] == -1) {
+								level[adjacency[v][k]] = level[v] + 1;
+								queue.push_back(adjacency[v][k]);
+							}
+						}
+					}
+					const int lastLevel = level[queue.back()];
+					start = queue.back();
+					for (size_t k = 0; k < queue.size(); k++) {
+						const int v = queue[k];
+						if (level[v] == lastLevel && adjacency[v].size() < adjacency[start].size()) {
+							start = v;
+						}
+					}
+					for (size_t k = 0; k < queue.size(); k++) {
+						level[queue[k]] = -1;
+					}
+
+					/// Cuthill-McKee: visit unnumbered neighbours by increasing degree
+					const size_t first = result.size();
+					result.push_back(start);
+					level[start] = 0;
+					for (size_t head = first; head < result.size(); head++) {
+						const int v = result[head];
+						std::vector<std::pair<size_t, int> > neighbours;
+						for (size_t k = 0; k < adjacency[v].size(); k++) {
+							const int w = adjacency[v][k];
+							if (level[w] == -1) {
+								level[w] = 0;
+								neighbours.push_back(std::make_pair(adjacency[w].size(), w));
+							}
+						}
+						std::sort(neighbours.begin(), neighbours.end());
+						for (size_t k = 0; k < neighbours.size(); k++) {
+							result.push_back(neighbours[k].second);
+						}
+					}
+				}
+
+				std::vector<Vertex*> sorted(n);
+				for (size_t i = 0; i < n; i++) {
+					sorted[i] = order[result[n-1-i]];
+				}
+				order.swap(sorted);
+			}
+
+			/// sorts elements by the smallest index of their vertices
+			template <class TElem>
+			void SortBySmallestVertex(std::vector<TElem*>& elems, Grid::VertexAttachmentAccessor<AInt>& aaIndex) {
+				std::vector<std::pair<int, size_t> > keys(elems.size());
+				for (size_t i = 0; i < elems.size(); i++) {
+					int key = aaIndex[elems[i]->vertex(0)];
+					for (size_t j = 1; j < elems[i]->num_vertices(); j++) {
+						key = std::min(key, aaIndex[elems[i]->vertex(j)]);
+					}
+					keys[i] = std::make_pair(key, i);
+				}
+				std::sort(keys.begin(), keys.end());
+
+				std::vector<TElem*> sorted(elems.size());
+				for (size_t i = 0; i < keys.size(); i++) {
+					sorted[i] = elems[keys[i].second];
+				}
+				elems.swap(sorted);
+			}
+
+			/// largest index difference of two vertices of the same element
+			template <class TElem>
+			size_t ElementBandwidth(Grid& g, Grid::VertexAttachmentAccessor<AInt>& aaIndex) {
+				size_t bandwidth = 0;
+				typedef typename Grid::traits<TElem>::iterator iterator;
+				for (iterator it = g.begin<TElem>(); it != g.end<TElem>(); ++it) {
+					TElem* elem = *it;
+					int minIndex = aaIndex[elem->vertex(0)];
+					int maxIndex = minIndex;
+					for (size_t i = 1; i < elem->num_vertices(); i++) {
+						minIndex = std::min(minIndex, aaIndex[elem->vertex(i)]);
+						maxIndex = std::max(maxIndex, aaIndex[elem->vertex(i)]);
+					}
+					bandwidth = std::max(bandwidth, static_cast<size_t>(maxIndex - minIndex));
+				}
+				return bandwidth;
+			}
+		}
+
+		////////////////////////////////////////////////////////////////////////////////
+		/// CalculateBandwidth
+		////////////////////////////////////////////////////////////////////////////////
+		size_t CalculateBandwidth
+		(
+			Grid& g
+		)
+		{
+			AInt aIndex;
+			g.attach_to_vertices(aIndex);
+			Grid::VertexAttachmentAccessor<AInt> aaIndex(g, aIndex);
+			int index = 0;
+			for (VertexIterator vit = g.begin<Vertex>(); vit != g.end<Vertex>(); ++vit) {
+				aaIndex[*vit] = index++;
+			}
+
+			/// elements of the highest dimension couple all their vertices, e.g. face diagonals of hexahedra
+			size_t bandwidth;
+			if (g.num<Volume>() > 0) {
+				bandwidth = ElementBandwidth<Volume>(g, aaIndex);
+			} else if (g.num<Face>() > 0) {
+				bandwidth = ElementBandwidth<Face>(g, aaIndex);
+			} else {
+				bandwidth = ElementBandwidth<Edge>(g, aaIndex);
+			}
+			g.detach_from_vertices(aIndex);
+			return bandwidth;
+		}
+
+		////////////////////////////////////////////////////////////////////////////////
+		/// IsReorderingMethod
+		////////////////////////////////////////////////////////////////////////////////
+		bool IsReorderingMethod
+		(
+			const std::string& method
+		)
+		{
+			return method == "hilbert" || method == "morton" || method == "rcm";
+		}
+
+		////////////////////////////////////////////////////////////////////////////////
+		/// ReorderGrid
+		////////////////////////////////////////////////////////////////////////////////
+		void ReorderGrid
+		(
+			Grid& g,
+			SubsetHandler& sh,
+			const std::string& method,
+			std::vector<VertexPairs>* pairs
+		)
+		{
+			UG_COND_THROW(!IsReorderingMethod(method),
+					"Unknown reordering '" << method << "', use hilbert, morton or rcm.");
+			if (g.num_vertices() == 0) {
+				return;
+			}
+			const size_t bandwidthBefore = CalculateBandwidth(g);
+
+			/// new vertex order
+			AInt aIndex;
+			g.attach_to_vertices(aIndex);
+			Grid::VertexAttachmentAccessor<AInt> aaIndex(g, aIndex);
+			std::vector<Vertex*> vrts(g.begin<Vertex>(), g.end<Vertex>());
+			for (size_t i = 0; i < vrts.size(); i++) {
+				aaIndex[vrts[i]] = static_cast<int>(i);
+			}
+			if (method == "rcm") {
+				RCMOrder(g, aaIndex, vrts);
+			} else {
+				CurveOrder(g, method == "hilbert", vrts);
+			}
+			for (size_t i = 0; i < vrts.size(); i++) {
+				aaIndex[vrts[i]] = static_cast<int>(i);
+			}
+
+			/// elements follow their vertices
+			std::vector<Edge*> edges(g.begin<Edge>(), g.end<Edge>());
+			std::vector<Face*> faces(g.begin<Face>(), g.end<Face>());
+			std::vector<Volume*> vols(g.begin<Volume>(), g.end<Volume>());
+			SortBySmallestVertex(edges, aaIndex);
+			SortBySmallestVertex(faces, aaIndex);
+			SortBySmallestVertex(vols, aaIndex);
+
+			/// vertex pairs refer to the new order, the vertices are recreated below
+			std::vector<std::vector<std::pair<int, int> > > pairIndices;
+			if (pairs) {
+				pairIndices.resize(pairs->size());
+				for (size_t i = 0; i < pairs->size(); i++) {
+					for (size_t j = 0; j < (*pairs)[i].size(); j++) {
+						pairIndices[i].push_back(std::make_pair(aaIndex[(*pairs)[i][j].first],
+								aaIndex[(*pairs)[i][j].second]));
+					}
+				}
+			}
+			g.detach_from_vertices(aIndex);
+
+			/// rebuild grid in the new order. lib_grid cannot reorder the elements of a
+			/// grid in place, and the caller's grid has to be kept since subset handler,
+			/// attachments and references are bound to it, thus copy there and back
+			Grid tmp;
+			SubsetHandler tmpSH(tmp);
+			tmp.attach_to_vertices(aPosition);
+			CopyGridElements(g, sh, vrts, edges, faces, vols, tmp, tmpSH);
+
+			vrts.assign(tmp.begin<Vertex>(), tmp.end<Vertex>());
+			edges.assign(tmp.begin<Edge>(), tmp.end<Edge>());
+			faces.assign(tmp.begin<Face>(), tmp.end<Face>());
+			vols.assign(tmp.begin<Volume>(), tmp.end<Volume>());
+			g.clear_geometry();
+			CopyGridElements(tmp, tmpSH, vrts, edges, faces, vols, g, sh);
+
+			if (pairs) {
+				vrts.assign(g.begin<Vertex>(), g.end<Vertex>());
+				for (size_t i = 0; i < pairs->size(); i++) {
+					for (size_t j = 0; j < (*pairs)[i].size(); j++) {
+						(*pairs)[i][j] = std::make_pair(vrts[pairIndices[i][j].first], vrts[pairIndices[i][j].second]);
+					}
+				}
+			}
+
+			UG_LOGN("Reordering (" << method << "): bandwidth " << bandwidthBefore
+					<< " -> " << CalculateBandwidth(g))
+		}
+	}
+}
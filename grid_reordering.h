@@ -0,0 +1,58 @@
+/*!
+ * \file grid_reordering.h
+ * Author: Stephan Grein
+ */
+#ifndef UG__PLUGINS__CRACK_GENERATOR__GRID_REORDERING_H
+#define UG__PLUGINS__CRACK_GENERATOR__GRID_REORDERING_H
+
+#include "lib_grid/lib_grid.h"
+#include "crack_generator_util.h"
+#include <string>
+#include <vector>
+
+namespace ug {
+	namespace crack_generator {
+		/*!
+		 * \brief bandwidth of the vertex coupling in the current vertex order
+		 * Vertices are coupled if they belong to the same element of the highest
+		 * dimension, as in a matrix assembled on the grid.
+		 * \param[in] g grid
+		 * \return largest difference of the vertex indices of an element
+		 */
+		size_t CalculateBandwidth
+		(
+			Grid& g
+		);
+
+		/*!
+		 * \brief checks if ReorderGrid knows the given method
+		 * \param[in] method reordering method
+		 * \return true for "hilbert", "morton" and "rcm"
+		 */
+		bool IsReorderingMethod
+		(
+			const std::string& method
+		);
+
+		/*!
+		 * \brief renumbers vertices and elements for memory locality
+		 * Vertices are sorted along a space-filling curve ("hilbert", "morton")
+		 * or by reverse Cuthill-McKee ("rcm"). Edges, faces and volumes follow
+		 * the order of their smallest vertex. The grid is rebuilt in the new
+		 * order, subsets are kept and the bandwidth before and after is logged.
+		 * \param[in] g grid
+		 * \param[in] sh subset handler
+		 * \param[in] method reordering method
+		 * \param[in,out] pairs if given, vertex pairs which are moved to the rebuilt grid
+		 */
+		void ReorderGrid
+		(
+			Grid& g,
+			SubsetHandler& sh,
+			const std::string& method,
+			std::vector<VertexPairs>* pairs = NULL
+		);
+	}
+}
+
+#endif /// UG__PLUGINS__CRACK_GENERATOR__GRID_REORDERING_H
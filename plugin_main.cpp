@@ -18,8 +18,48 @@ InitUGPlugin_CrackGenerator(ug::bridge::Registry* reg, string parentGroup)
 {
   string grp(parentGroup);
   grp.append("CrackGenerator/");
-  reg->add_function("BuildCompleteCrack", &BuildCompleteCrack, "",
+  {
+	typedef AsyncGridWriter T;
+	reg->add_class_<T>("AsyncGridWriter", grp)
+		.add_constructor<void (*)(size_t)>("capacity")
+		.add_method("flush", &T::flush)
+		.add_method("capacity", &T::capacity)
+		.set_construct_as_smart_pointer(true);
+  }
+  {
+	typedef CrackGeneratorOptions T;
+	reg->add_class_<T>("CrackGeneratorOptions", grp)
+		.add_constructor()
+		.add_method("set_periodic", &T::set_periodic, "", "periodic")
+		.add_method("set_structured", &T::set_structured, "", "structured")
+		.add_method("set_structured_cells", &T::set_structured_cells, "", "numCells")
+		.add_method("set_structured_layers", &T::set_structured_layers, "", "numLayers")
+		.add_method("set_copy_top", &T::set_copy_top, "", "copyTop")
+		.add_method("set_validate_surface", &T::set_validate_surface, "", "validate")
+		.add_method("set_reordering", &T::set_reordering, "", "method (hilbert|morton|rcm)")
+		.add_method("set_writer", &T::set_writer, "", "writer")
+		.set_construct_as_smart_pointer(true);
+  }
+  reg->add_function("BuildCompleteCrack",
+		  static_cast<void (*)(ug::number, ug::number, ug::number, ug::number)>(&BuildCompleteCrack), "",
 		  "crackInnerLength#innerThickness#crackOuterLength#angle (degree)", grp);
-  reg->add_function("BuildSimpleCrack", &BuildSimpleCrack, "",
+  reg->add_function("BuildCompleteCrack",
+		  static_cast<void (*)(ug::number, ug::number, ug::number, ug::number,
+				  const CrackGeneratorOptions&)>(&BuildCompleteCrack), "",
+		  "crackInnerLength#innerThickness#crackOuterLength#angle (degree)#options", grp);
+  reg->add_function("BuildSimpleCrack",
+		  static_cast<void (*)(ug::number, ug::number, ug::number, ug::number, ug::number, ug::number, ug::number)>(&BuildSimpleCrack), "",
 		  "height#width#depth#thickness#spacing#h#r_0", grp);
+  reg->add_function("BuildSimpleCrack",
+		  static_cast<void (*)(ug::number, ug::number, ug::number, ug::number, ug::number, ug::number, ug::number,
+				  const CrackGeneratorOptions&)>(&BuildSimpleCrack), "",
+		  "height#width#depth#thickness#spacing#h#r_0#options", grp);
+  reg->add_function("BuildSimpleCrackArray",
+		  static_cast<void (*)(ug::number, ug::number, ug::number, ug::number, ug::number, ug::number, ug::number,
+				  size_t, size_t, size_t)>(&BuildSimpleCrackArray), "",
+		  "height#width#depth#thickness#spacing#h#r_0#nx#ny#nz", grp);
+  reg->add_function("BuildSimpleCrackArray",
+		  static_cast<void (*)(ug::number, ug::number, ug::number, ug::number, ug::number, ug::number, ug::number,
+				  size_t, size_t, size_t, const CrackGeneratorOptions&)>(&BuildSimpleCrackArray), "",
+		  "height#width#depth#thickness#spacing#h#r_0#nx#ny#nz#options", grp);
 }
@@ -0,0 +1,391 @@
+/*!
+ * \file surface_validation.cpp
+ * Author: Stephan Grein
+ */
+
+#include "surface_validation.h"
+#include "crack_generator_util.h"
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ug {
+	namespace crack_generator {
+		namespace {
+			/// sorted vertices of a face
+			struct FaceKey {
+				Vertex* vrts[4];
+				bool operator==(const FaceKey& other) const {
+					return std::equal(vrts, vrts+4, other.vrts);
+				}
+			};
+
+			struct FaceKeyHash {
+				size_t operator()(const FaceKey& key) const {
+					size_t hash = 0;
+					for (size_t i = 0; i < 4; i++) {
+						hash = hash * 31 + reinterpret_cast<size_t>(key.vrts[i]);
+					}
+					return hash;
+				}
+			};
+
+			std::string SubsetName(SubsetHandler& sh, int si) {
+				return si >= 0 ? sh.subset_info(si).name : std::string("none");
+			}
+
+			CellKey Cell(const vector3& pos, const vector3& origin, const vector3& cellSize) {
+				return CellKey(static_cast<long>(std::floor((pos.x() - origin.x()) / cellSize.x())),
+						static_cast<long>(std::floor((pos.y() - origin.y()) / cellSize.y())),
+						static_cast<long>(std::floor((pos.z() - origin.z()) / cellSize.z())));
+			}
+
+			/// splits quadrilaterals along the diagonal starting at vertex 0
+			size_t FaceTriangles(Face* f, Grid::VertexAttachmentAccessor<APosition>& aaPos, vector3 tris[2][3]) {
+				tris[0][0] = aaPos[f->vertex(0)];
+				tris[0][1] = aaPos[f->vertex(1)];
+				tris[0][2] = aaPos[f->vertex(2)];
+				if (f->num_vertices() < 4) {
+					return 1;
+				}
+				tris[1][0] = aaPos[f->vertex(0)];
+				tris[1][1] = aaPos[f->vertex(2)];
+				tris[1][2] = aaPos[f->vertex(3)];
+				return 2;
+			}
+
+			size_t NumSharedVertices(Face* f1, Face* f2) {
+				size_t num = 0;
+				for (size_t i = 0; i < f1->num_vertices(); i++) {
+					for (size_t j = 0; j < f2->num_vertices(); j++) {
+						if (f1->vertex(i) == f2->vertex(j)) {
+							num++;
+						}
+					}
+				}
+				return num;
+			}
+
+			/// moves the corners towards the centroid, thus shared corners and edges no longer touch
+			void ShrinkTriangle(vector3* tri, number factor) {
+				vector3 center;
+				VecAdd(center, tri[0], tri[1], tri[2]);
+				VecScale(center, center, 1.0 / 3.0);
+				for (size_t i = 0; i < 3; i++) {
+					VecScaleAdd(tri[i], 1.0 - factor, tri[i], factor, center);
+				}
+			}
+
+			/// faces around a vertex which are not connected by edges through the vertex
+			bool IsPinched(Grid& g, Vertex* v) {
+				/// (other vertex of an edge through v, face index), faces are joined by equal other vertices
+				std::vector<std::pair<Vertex*, size_t> > fanEdges;
+				std::vector<size_t> component;
+				for (Grid::AssociatedFaceIterator fit = g.associated_faces_begin(v);
+						fit != g.associated_faces_end(v); ++fit) {
+					Face* f = *fit;
+					const size_t n = f->num_vertices();
+					for (size_t i = 0; i < n; i++) {
+						if (f->vertex(i) == v) {
+							fanEdges.push_back(std::make_pair(f->vertex((i+1) % n), component.size()));
+							fanEdges.push_back(std::make_pair(f->vertex((i+n-1) % n), component.size()));
+							break;
+						}
+					}
+					component.push_back(component.size());
+				}
+				if (component.size() < 2) {
+					return false;
+				}
+
+				std::sort(fanEdges.begin(), fanEdges.end());
+				for (size_t i = 1; i < fanEdges.size(); i++) {
+					if (fanEdges[i].first != fanEdges[i-1].first) {
+						continue;
+					}
+					/// relabel the component of the second face
+					const size_t from = component[fanEdges[i].second];
+					const size_t to = component[fanEdges[i-1].second];
+					for (size_t j = 0; j < component.size(); j++) {
+						if (component[j] == from) {
+							component[j] = to;
+						}
+					}
+				}
+				for (size_t j = 1; j < component.size(); j++) {
+					if (component[j] != component[0]) {
+						return true;
+					}
+				}
+				return false;
+			}
+
+			/// separating axis test, triangles closer than eps count as intersecting
+			bool TrianglesIntersect(const vector3* a, const vector3* b, number eps) {
+				vector3 ea[3], eb[3], na, nb;
+				for (size_t i = 0; i < 3; i++) {
+					VecSubtract(ea[i], a[(i+1) % 3], a[i]);
+					VecSubtract(eb[i], b[(i+1) % 3], b[i]);
+				}
+				VecCross(na, ea[0], ea[1]);
+				VecCross(nb, eb[0], eb[1]);
+
+				/// face normals, edge-edge directions and in-plane edge normals for coplanar triangles,
+				/// each with the product of the lengths of its factors
+				std::vector<std::pair<vector3, number> > axes;
+				axes.reserve(17);
+				axes.push_back(std::make_pair(na, VecLength(ea[0]) * VecLength(ea[1])));
+				axes.push_back(std::make_pair(nb, VecLength(eb[0]) * VecLength(eb[1])));
+				for (size_t i = 0; i < 3; i++) {
+					vector3 axis;
+					for (size_t j = 0; j < 3; j++) {
+						VecCross(axis, ea[i], eb[j]);
+						axes.push_back(std::make_pair(axis, VecLength(ea[i]) * VecLength(eb[j])));
+					}
+					VecCross(axis, na, ea[i]);
+					axes.push_back(std::make_pair(axis, VecLength(na) * VecLength(ea[i])));
+					VecCross(axis, nb, eb[i]);
+					axes.push_back(std::make_pair(axis, VecLength(nb) * VecLength(eb[i])));
+				}
+
+				for (size_t k = 0; k < axes.size(); k++) {
+					/// skip parallel factors, relative to their lengths since the axes are not normalized
+					const number length = VecLength(axes[k].first);
+					if (!(length > SMALL * axes[k].second)) {
+						continue;
+					}
+					const vector3& axis = axes[k].first;
+					number minA = VecDot(a[0], axis), maxA = minA;
+					number minB = VecDot(b[0], axis), maxB = minB;
+					for (size_t i = 1; i < 3; i++) {
+						const number pa = VecDot(a[i], axis);
+						const number pb = VecDot(b[i], axis);
+						minA = std::min(minA, pa); maxA = std::max(maxA, pa);
+						minB = std::min(minB, pb); maxB = std::max(maxB, pb);
+					}
+					if (minB - maxA > eps * length || minA - maxB > eps * length) {
+						return false;
+					}
+				}
+				return true;
+			}
+		}
+
+		////////////////////////////////////////////////////////////////////////////////
+		/// CheckSurface
+		////////////////////////////////////////////////////////////////////////////////
+		size_t CheckSurface
+		(
+			Grid& g,
+			SubsetHandler& sh,
+			Grid::VertexAttachmentAccessor<APosition>& aaPos,
+			size_t maxLogged
+		)
+		{
+			if (g.num_vertices() == 0) {
+				return 0;
+			}
+			vector3 boxMin, boxMax;
+			CalculateGridBox(g, aaPos, boxMin, boxMax);
+			const number tol = 1e-8 * VecDistance(boxMin, boxMax);
+
+			/// open edges: count faces per edge
+			size_t numOpen = 0;
+			AInt aNumFaces;
+			g.attach_to_edges_dv(aNumFaces, 0);
+			Grid::EdgeAttachmentAccessor<AInt> aaNumFaces(g, aNumFaces);
+			for (FaceIterator fit = g.begin<Face>(); fit != g.end<Face>(); ++fit) {
+				Face* f = *fit;
+				for (size_t i = 0; i < f->num_vertices(); i++) {
+					Edge* e = g.get_edge(f->vertex(i), f->vertex((i+1) % f->num_vertices()));
+					if (e) {
+						aaNumFaces[e]++;
+					}
+				}
+			}
+			for (EdgeIterator eit = g.begin<Edge>(); eit != g.end<Edge>(); ++eit) {
+				if (aaNumFaces[*eit] != 1) {
+					continue;
+				}
+				if (numOpen++ < maxLogged) {
+					UG_LOGN("Open edge at " << CalculateCenter(*eit, aaPos)
+							<< " in subset " << SubsetName(sh, sh.get_subset_index(*eit)))
+				}
+			}
+			g.detach_from_edges(aNumFaces);
+
+			/// non-manifold vertices: the faces around a vertex have to be connected by their edges,
+			/// this holds for internal facets as well, but not for surfaces touching in a single vertex
+			size_t numPinched = 0;
+			for (VertexIterator vit = g.begin<Vertex>(); vit != g.end<Vertex>(); ++vit) {
+				if (IsPinched(g, *vit) && numPinched++ < maxLogged) {
+					UG_LOGN("Non-manifold vertex at " << aaPos[*vit] << " in subset "
+							<< SubsetName(sh, sh.get_subset_index(*vit)))
+				}
+			}
+
+			/// duplicate vertices: compare with the vertices of the neighbouring cells
+			size_t numDoubleVrts = 0;
+			std::unordered_map<CellKey, std::vector<Vertex*>, CellKeyHash> vrtCells;
+			const vector3 vrtCellSize(tol, tol, tol);
+			for (VertexIterator vit = g.begin<Vertex>(); vit != g.end<Vertex>(); ++vit) {
+				const vector3& pos = aaPos[*vit];
+				const CellKey key = Cell(pos, boxMin, vrtCellSize);
+				bool isDouble = false;
+				for (long di = -1; di <= 1 && !isDouble; di++) {
+					for (long dj = -1; dj <= 1 && !isDouble; dj++) {
+						for (long dk = -1; dk <= 1 && !isDouble; dk++) {
+							std::unordered_map<CellKey, std::vector<Vertex*>, CellKeyHash>::const_iterator it
+								= vrtCells.find(CellKey(key.i+di, key.j+dj, key.k+dk));
+							if (it == vrtCells.end()) {
+								continue;
+							}
+							for (size_t i = 0; i < it->second.size() && !isDouble; i++) {
+								isDouble = VecDistance(aaPos[it->second[i]], pos) <= tol;
+							}
+						}
+					}
+				}
+				if (isDouble && numDoubleVrts++ < maxLogged) {
+					UG_LOGN("Duplicate vertex at " << pos << " in subset "
+							<< SubsetName(sh, sh.get_subset_index(*vit)))
+				}
+				vrtCells[key].push_back(*vit);
+			}
+
+			/// duplicate faces: hash the sorted vertices of each face
+			size_t numDoubleFaces = 0;
+			std::unordered_map<FaceKey, Face*, FaceKeyHash> faceKeys;
+			std::vector<Face*> faces(g.begin<Face>(), g.end<Face>());
+			for (size_t i = 0; i < faces.size(); i++) {
+				FaceKey key;
+				std::fill(key.vrts, key.vrts+4, static_cast<Vertex*>(NULL));
+				for (size_t j = 0; j < faces[i]->num_vertices() && j < 4; j++) {
+					key.vrts[j] = faces[i]->vertex(j);
+				}
+				std::sort(key.vrts, key.vrts+4);
+				if (faceKeys.insert(std::make_pair(key, faces[i])).second) {
+					continue;
+				}
+				if (numDoubleFaces++ < maxLogged) {
+					UG_LOGN("Duplicate face at " << CalculateCenter(faces[i], aaPos) << " in subsets "
+							<< SubsetName(sh, sh.get_subset_index(faces[i])) << " and "
+							<< SubsetName(sh, sh.get_subset_index(faceKeys[key])))
+				}
+			}
+
+			/// intersecting faces: bin bounding boxes, cell sizes are the mean extents per direction
+			size_t numIntersections = 0;
+			std::vector<vector3> faceMin(faces.size()), faceMax(faces.size());
+			vector3 cellSize(0, 0, 0);
+			for (size_t i = 0; i < faces.size(); i++) {
+				faceMin[i] = faceMax[i] = aaPos[faces[i]->vertex(0)];
+				for (size_t j = 1; j < faces[i]->num_vertices(); j++) {
+					const vector3& pos = aaPos[faces[i]->vertex(j)];
+					for (size_t d = 0; d < 3; d++) {
+						faceMin[i][d] = std::min(faceMin[i][d], pos[d]);
+						faceMax[i][d] = std::max(faceMax[i][d], pos[d]);
+					}
+				}
+				for (size_t d = 0; d < 3; d++) {
+					cellSize[d] += (faceMax[i][d] - faceMin[i][d]) / faces.size();
+				}
+			}
+			for (size_t d = 0; d < 3; d++) {
+				cellSize[d] = std::max(cellSize[d], tol);
+			}
+
+			std::unordered_map<CellKey, std::vector<size_t>, CellKeyHash> faceCells;
+			for (size_t i = 0; i < faces.size(); i++) {
+				const CellKey lo = Cell(faceMin[i], boxMin, cellSize);
+				const CellKey hi = Cell(faceMax[i], boxMin, cellSize);
+				for (long ci = lo.i; ci <= hi.i; ci++) {
+					for (long cj = lo.j; cj <= hi.j; cj++) {
+						for (long ck = lo.k; ck <= hi.k; ck++) {
+							faceCells[CellKey(ci, cj, ck)].push_back(i);
+						}
+					}
+				}
+			}
+
+			std::unordered_map<CellKey, std::vector<size_t>, CellKeyHash>::const_iterator cit = faceCells.begin();
+			for (; cit != faceCells.end(); ++cit) {
+				const std::vector<size_t>& cell = cit->second;
+				for (size_t m = 0; m < cell.size(); m++) {
+					for (size_t n = m+1; n < cell.size(); n++) {
+						const size_t i = cell[m];
+						const size_t j = cell[n];
+						/// test each pair only in the first cell both boxes share
+						vector3 commonMin;
+						bool overlap = true;
+						for (size_t d = 0; d < 3; d++) {
+							commonMin[d] = std::max(faceMin[i][d], faceMin[j][d]);
+							overlap = overlap && faceMin[i][d] <= faceMax[j][d] + tol
+								&& faceMin[j][d] <= faceMax[i][d] + tol;
+						}
+						if (!overlap || !(Cell(commonMin, boxMin, cellSize) == cit->first)) {
+							continue;
+						}
+						/// faces on the same vertices are counted as duplicates already
+						const size_t numShared = NumSharedVertices(faces[i], faces[j]);
+						if (numShared == faces[i]->num_vertices() && numShared == faces[j]->num_vertices()) {
+							continue;
+						}
+						vector3 trisI[2][3], trisJ[2][3];
+						const size_t numI = FaceTriangles(faces[i], aaPos, trisI);
+						const size_t numJ = FaceTriangles(faces[j], aaPos, trisJ);
+						/// neighbours touch in their shared vertices or edge, only overlaps beyond these count,
+						/// e.g. a fold back of a face onto its neighbour
+						if (numShared > 0) {
+							for (size_t ti = 0; ti < numI; ti++) {
+								ShrinkTriangle(trisI[ti], 1e-3);
+							}
+							for (size_t tj = 0; tj < numJ; tj++) {
+								ShrinkTriangle(trisJ[tj], 1e-3);
+							}
+						}
+						const number eps = numShared > 0 ? 0 : tol;
+						bool intersect = false;
+						for (size_t ti = 0; ti < numI && !intersect; ti++) {
+							for (size_t tj = 0; tj < numJ && !intersect; tj++) {
+								intersect = TrianglesIntersect(trisI[ti], trisJ[tj], eps);
+							}
+						}
+						if (intersect && numIntersections++ < maxLogged) {
+							UG_LOGN("Intersecting faces at " << CalculateCenter(faces[i], aaPos)
+									<< " (subset " << SubsetName(sh, sh.get_subset_index(faces[i]))
+									<< ") and " << CalculateCenter(faces[j], aaPos)
+									<< " (subset " << SubsetName(sh, sh.get_subset_index(faces[j])) << ")")
+						}
+					}
+				}
+			}
+
+			if (numOpen || numPinched || numDoubleVrts || numDoubleFaces || numIntersections) {
+				UG_LOGN("Surface check: " << numOpen << " open edges, " << numPinched
+						<< " non-manifold vertices, " << numDoubleVrts
+						<< " duplicate vertices, " << numDoubleFaces << " duplicate faces, "
+						<< numIntersections << " intersecting face pairs")
+			}
+			return numOpen + numPinched + numDoubleVrts + numDoubleFaces + numIntersections;
+		}
+
+		////////////////////////////////////////////////////////////////////////////////
+		/// ValidateSurface
+		////////////////////////////////////////////////////////////////////////////////
+		void ValidateSurface
+		(
+			Grid& g,
+			SubsetHandler& sh,
+			Grid::VertexAttachmentAccessor<APosition>& aaPos
+		)
+		{
+			UG_LOGN("Validating surface...")
+			size_t numDefects = CheckSurface(g, sh, aaPos);
+			UG_COND_THROW(numDefects, "Surface is not valid for tetrahedralization, "
+					<< numDefects << " offending elements found (see log).");
+		}
+	}
+}
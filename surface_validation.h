@@ -0,0 +1,50 @@
+/*!
+ * \file surface_validation.h
+ * Author: Stephan Grein
+ */
+#ifndef UG__PLUGINS__CRACK_GENERATOR__SURFACE_VALIDATION_H
+#define UG__PLUGINS__CRACK_GENERATOR__SURFACE_VALIDATION_H
+
+#include "lib_grid/lib_grid.h"
+
+namespace ug {
+	namespace crack_generator {
+		/*!
+		 * \brief checks the surface grid before it is handed to TetGen
+		 * Looks for open edges (only one adjacent face), non-manifold vertices
+		 * (faces around the vertex not connected by edges), duplicate vertices,
+		 * duplicate faces and faces which intersect or touch without sharing a
+		 * vertex. Edges with more than two faces are allowed, since the generators
+		 * hand internal facets to TetGen as well. Vertices and faces are binned
+		 * into a spatial hash, thus the check is near-linear in the grid size.
+		 * Offending elements are logged with their subsets.
+		 * \param[in] g grid
+		 * \param[in] sh subset handler
+		 * \param[in] aaPos positions
+		 * \param[in] maxLogged number of logged elements per kind of defect
+		 * \return number of offending elements
+		 */
+		size_t CheckSurface
+		(
+			Grid& g,
+			SubsetHandler& sh,
+			Grid::VertexAttachmentAccessor<APosition>& aaPos,
+			size_t maxLogged = 10
+		);
+
+		/*!
+		 * \brief throws if CheckSurface finds any offending element
+		 * \param[in] g grid
+		 * \param[in] sh subset handler
+		 * \param[in] aaPos positions
+		 */
+		void ValidateSurface
+		(
+			Grid& g,
+			SubsetHandler& sh,
+			Grid::VertexAttachmentAccessor<APosition>& aaPos
+		);
+	}
+}
+
+#endif /// UG__PLUGINS__CRACK_GENERATOR__SURFACE_VALIDATION_H